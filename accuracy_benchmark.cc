@@ -2,7 +2,8 @@
 
 #include <iostream>
 #include <numeric>
-#include <tuple>
+#include <string>
+#include <vector>
 
 #include "aircraft_finder.h"
 #include "aircraft_generator.h"
@@ -12,7 +13,8 @@ using namespace std;
 
 void PrintUsage(const char* exec_name) {
   cerr << "Usage: " << exec_name << " -r rows -c cols -n aircrafts -g games"
-       << endl;
+       << " [-e dfs|graph] [-t endgame_threshold] [-k shots]"
+       << " [-p entropy|count]" << endl;
 }
 
 class Histogram {
@@ -69,9 +71,13 @@ int main(int argc, char* argv[]) {
   int cols = 0;
   int num_aircrafts = 0;
   int num_games = 0;
+  Engine engine = kDFSEngine;
+  ScoringPolicy scoring_policy = kEntropyPolicy;
+  int endgame_threshold = -1;
+  int num_shots = 1;
 
   int opt;
-  while ((opt = getopt(argc, argv, "r:c:n:g:")) != -1) {
+  while ((opt = getopt(argc, argv, "r:c:n:g:e:t:k:p:")) != -1) {
     switch (opt) {
       case 'r':
         rows = atoi(optarg);
@@ -85,13 +91,40 @@ int main(int argc, char* argv[]) {
       case 'g':
         num_games = atoi(optarg);
         break;
+      case 'e':
+        if (string(optarg) == "dfs") {
+          engine = kDFSEngine;
+        } else if (string(optarg) == "graph") {
+          engine = kCompatibilityGraphEngine;
+        } else {
+          PrintUsage(argv[0]);
+          return 1;
+        }
+        break;
+      case 't':
+        endgame_threshold = atoi(optarg);
+        break;
+      case 'k':
+        num_shots = atoi(optarg);
+        break;
+      case 'p':
+        if (string(optarg) == "entropy") {
+          scoring_policy = kEntropyPolicy;
+        } else if (string(optarg) == "count") {
+          scoring_policy = kCountPolicy;
+        } else {
+          PrintUsage(argv[0]);
+          return 1;
+        }
+        break;
       default:
         PrintUsage(argv[0]);
         return 1;
     }
   }
 
-  if (rows <= 0 || cols <= 0 || num_aircrafts <= 0 || num_games <= 0) {
+  if (rows <= 0 || cols <= 0 || num_aircrafts <= 0 || num_games <= 0 ||
+      num_shots <= 0) {
     PrintUsage(argv[0]);
     return 1;
   }
@@ -104,18 +137,27 @@ int main(int argc, char* argv[]) {
     vector<vector<Color>> board = generator.Generate();
 
     AircraftFinder finder(rows, cols, num_aircrafts);
+    finder.SetEngine(engine);
+    finder.SetScoringPolicy(scoring_policy);
+    if (endgame_threshold >= 0) {
+      finder.SetEndgameThreshold(endgame_threshold);
+    }
     int num_remaining_aircrafts = num_aircrafts;
     int num_guesses = 0;
+    // With several shots, a guess is a whole salvo.
     while (num_remaining_aircrafts > 0) {
       num_guesses++;
 
-      int x;
-      int y;
-      tie(x, y) = finder.GetCellToBomb(false);
-      finder.SetColor(x, y, board[x][y]);
-      if (board[x][y] == kRed) {
-        num_remaining_aircrafts--;
+      vector<Observation> observations;
+      for (const pair<int, int>& cell :
+           finder.GetCellsToBomb(num_shots, false)) {
+        const Color color = board[cell.first][cell.second];
+        observations.push_back(Observation{cell.first, cell.second, color});
+        if (color == kRed) {
+          num_remaining_aircrafts--;
+        }
       }
+      finder.SetColors(observations);
     }
 
     cerr << "Game " << i << ": " << num_guesses << endl;
@@ -4,6 +4,7 @@
 
 #include <algorithm>
 #include <cmath>
+#include <functional>
 #include <future>
 #include <iostream>
 #include <memory>
@@ -13,7 +14,12 @@
 #include <vector>
 
 #include "aircraft_placer.h"
+#include "bitset_ops.h"
 #include "color.h"
+#include "compatibility_graph.h"
+#include "decision_buffer.h"
+#include "endgame_solver.h"
+#include "placement_table.h"
 
 using namespace std;
 
@@ -72,120 +78,241 @@ struct CellProbability {
   Probability prob;
 };
 
-struct AircraftPosition {
-  int x;
-  int y;
-  int dir;
+// What is left to enumerate once the solved aircrafts are fixed in place.
+struct SearchSpace {
+  vector<AircraftPosition> solved;
+  // Cells covered by the solved aircrafts.
+  vector<vector<bool>> occupied;
+  int num_aircrafts;
+  // Red or blue cells not covered by the solved aircrafts.
+  int num_known_bodies;
 };
 
+// Placements [begin, end) of a PlacementTable, handed to a worker at once.
+struct PlacementRange {
+  int begin;
+  int end;
+};
+
+// How many configurations each placement of a PlacementTable takes part in,
+// alone and, for salvos, together with each later placement.
+struct PlacementCounts {
+  void Reset(const int n, const bool with_pairs) {
+    num_placements = n;
+    single.assign(n, 0);
+    pairs.assign(with_pairs ? n * (n - 1) / 2 : 0, 0);
+  }
+
+  PlacementCounts& operator+=(const PlacementCounts& other) {
+    for (int i = 0; i < num_placements; i++) {
+      single[i] += other.single[i];
+    }
+    for (int i = 0, n = pairs.size(); i < n; i++) {
+      pairs[i] += other.pairs[i];
+    }
+    return *this;
+  }
+
+  // Credits placement `i` and its pairs with `others` with
+  // `num_combinations` configurations. `others` come before `i`.
+  void Add(const int i, const int* others, const int num_others,
+           const int64_t num_combinations) {
+    single[i] += num_combinations;
+    for (int k = 0; k < num_others; k++) {
+      pairs[PairIndex(others[k], i)] += num_combinations;
+    }
+  }
+
+  int64_t Pair(const int i, const int j) const {
+    return i < j ? pairs[PairIndex(i, j)] : pairs[PairIndex(j, i)];
+  }
+
+  // Position of the pair i < j in the upper triangle, row by row.
+  int PairIndex(const int i, const int j) const {
+    return i * (2 * num_placements - i - 1) / 2 + j - i - 1;
+  }
+
+  int num_placements = 0;
+  vector<int64_t> single;
+  // The pairs i < j at PairIndex(i, j). Empty unless asked for.
+  vector<int64_t> pairs;
+};
+
+template <typename T>
 class Workqueue {
  public:
-  void Add(const AircraftPosition& pos) {
+  void Add(const T& item) {
     lock_guard<mutex> guard(mutex_);
-    workqueue_.push(pos);
+    workqueue_.push(item);
   }
 
-  bool Pop(AircraftPosition* pos) {
+  bool Pop(T* item) {
     lock_guard<mutex> guard(mutex_);
     if (workqueue_.empty()) {
       return false;
     }
-    *pos = workqueue_.front();
+    *item = workqueue_.front();
     workqueue_.pop();
     return true;
   }
 
  private:
-  queue<AircraftPosition> workqueue_;
+  queue<T> workqueue_;
   mutex mutex_;
 };
 
+// Scratch memory of one DFS worker. It is sized once per finder, except for
+// the placement counts that salvos size before each search, so the search
+// itself never allocates.
+class DFSArena {
+ public:
+  DFSArena(const int r, const int c, const int num_aircrafts,
+           const int aircraft_size)
+      : occupied(r * c),
+        occupied_bits(BitsetWords(r * c)),
+        placed(num_aircrafts * aircraft_size),
+        aircraft_positions(num_aircrafts),
+        placement_indices(num_aircrafts),
+        last_counts(r * c * 4),
+        heatmap(r, c) {}
+
+  // Cells taken by the aircrafts placed so far, in row-major order.
+  vector<char> occupied;
+  // The same cells as a bitset.
+  vector<uint64_t> occupied_bits;
+  // Stack of the cells of the aircrafts placed so far.
+  vector<pair<int, int>> placed;
+  // Stack of the aircrafts placed so far.
+  vector<AircraftPosition> aircraft_positions;
+  // The same aircrafts as indices into the placement table.
+  vector<int> placement_indices;
+  // For each placement, the number of configurations it completes as the
+  // last aircraft.
+  vector<int64_t> last_counts;
+  // Only gathered for salvos.
+  PlacementCounts placement_counts;
+  Heatmap heatmap;
+};
+
 class DFSHelper {
  public:
-  DFSHelper(const vector<vector<Color>>& board, const int num_aircrafts,
-            Workqueue& workqueue)
-      : board_(board),
-        r_(board.size()),
+  // Also fills the placement counts of the arena when `count_placements`.
+  DFSHelper(const vector<vector<Color>>& board, const SearchSpace& space,
+            const PlacementTable& table, Workqueue<PlacementRange>& workqueue,
+            DFSArena& arena, const bool count_placements)
+      : r_(board.size()),
         c_(board[0].size()),
-        num_aircrafts_(num_aircrafts),
+        space_(space),
+        num_aircrafts_(space.num_aircrafts),
+        table_(table),
+        num_cell_words_(table.NumCellWords()),
         workqueue_(workqueue),
-        placer_(board) {}
+        placer_(board),
+        occupied_(arena.occupied.data()),
+        occupied_bits_(arena.occupied_bits.data()),
+        placed_end_(arena.placed.data()),
+        aircraft_positions_(arena.aircraft_positions.data()),
+        placement_indices_(arena.placement_indices.data()),
+        last_counts_(arena.last_counts.data()),
+        placement_counts_(count_placements ? &arena.placement_counts
+                                           : nullptr),
+        heatmap_(arena.heatmap) {}
 
-  Heatmap ComputeHeatmap() const {
-    int known_bodies = 0;
+  // Leaves the heatmap in the arena.
+  void ComputeHeatmap() {
+    fill(occupied_bits_, occupied_bits_ + num_cell_words_, 0);
     for (int x = 0; x < r_; x++) {
       for (int y = 0; y < c_; y++) {
-        known_bodies += (board_[x][y] == kBlue || board_[x][y] == kRed);
+        occupied_[x * c_ + y] = space_.occupied[x][y];
+        if (space_.occupied[x][y]) {
+          BitsetSet(occupied_bits_, x * c_ + y);
+        }
+        heatmap_[x][y] = Frequency();
       }
     }
 
-    vector<AircraftPosition> aircraft_positions;
-    aircraft_positions.reserve(num_aircrafts_);
-
-    vector<vector<bool>> occupied(r_, vector<bool>(c_));
-
-    Heatmap heatmap(r_, c_);
-    int num_combinations =
-        DFS(known_bodies, aircraft_positions, occupied, heatmap);
+    const int64_t num_combinations = DFS(space_.num_known_bodies, 0);
+    for (int i = 0, n = table_.NumPlacements(); i < n; i++) {
+      if (last_counts_[i] == 0) {
+        continue;
+      }
+      const Placement& pos = table_.GetPlacement(i);
+      for (const pair<int, int>& body : placer_.GetAircraftBody(pos.dir)) {
+        if (body.first == 0 && body.second == 0) {
+          heatmap_[pos.x][pos.y].red += last_counts_[i];
+        } else {
+          heatmap_[pos.x + body.first][pos.y + body.second].blue +=
+              last_counts_[i];
+        }
+      }
+      last_counts_[i] = 0;
+    }
     for (int x = 0; x < r_; x++) {
       for (int y = 0; y < c_; y++) {
-        heatmap[x][y].white =
-            num_combinations - heatmap[x][y].red - heatmap[x][y].blue;
+        heatmap_[x][y].white =
+            num_combinations - heatmap_[x][y].red - heatmap_[x][y].blue;
       }
     }
-    return heatmap;
   }
 
  private:
-  int DFS(const int num_remaining_known_bodies,
-          vector<AircraftPosition>& aircraft_positions,
-          vector<vector<bool>>& occupied, Heatmap& heatmap) const {
-    if ((num_aircrafts_ - (int)aircraft_positions.size()) *
-            placer_.AircraftSize() <
+  int64_t DFS(const int num_remaining_known_bodies, const int num_placed) {
+    if ((num_aircrafts_ - num_placed) * placer_.AircraftSize() <
         num_remaining_known_bodies) {
       return 0;
     }
 
-    if (num_aircrafts_ == (int)aircraft_positions.size()) {
-      UpdateHeatmap(aircraft_positions, heatmap);
+    if (num_aircrafts_ == num_placed) {
+      UpdateHeatmap(num_placed, 1);
       return 1;
     }
 
-    vector<pair<int, int>> placed;
-    placed.reserve(placer_.AircraftSize());
+    if (num_placed > 0 && num_aircrafts_ == num_placed + 1) {
+      return CountLastAircraft(num_remaining_known_bodies, num_placed);
+    }
 
-    auto Process = [this, &aircraft_positions, &occupied, &heatmap, &placed](
+    auto Process = [this, num_placed](
                        int x, int y, int dir,
-                       int num_remaining_known_bodies) -> int {
-      int num_combinations = 0;
+                       int num_remaining_known_bodies) -> int64_t {
+      int64_t num_combinations = 0;
 
-      if (placer_.TryLand(x, y, dir, &occupied, &placed)) {
-        for (const pair<int, int>& p : placed) {
-          if (board_[p.first][p.second] != kGray) {
-            num_remaining_known_bodies--;
-          }
+      pair<int, int>* placed_begin = placed_end_;
+      if (placer_.TryLand(x, y, dir, occupied_, &placed_end_)) {
+        // Anything that lands here also lands on the board of the table.
+        const int i = table_.Find(x, y, dir);
+        const uint64_t* footprint = table_.GetFootprint(i);
+        BitsetOr(footprint, occupied_bits_, num_cell_words_);
+        aircraft_positions_[num_placed] = AircraftPosition{x, y, dir};
+        placement_indices_[num_placed] = i;
+        num_combinations =
+            DFS(num_remaining_known_bodies - table_.GetPlacement(i).num_known,
+                num_placed + 1);
+        if (placement_counts_ != nullptr) {
+          placement_counts_->Add(i, placement_indices_, num_placed,
+                                 num_combinations);
         }
-        aircraft_positions.push_back(AircraftPosition{x, y, dir});
-        num_combinations = DFS(num_remaining_known_bodies, aircraft_positions,
-                               occupied, heatmap);
-        aircraft_positions.pop_back();
+        BitsetAndNot(occupied_bits_, footprint, occupied_bits_,
+                     num_cell_words_);
       }
-      placer_.Lift(&occupied, &placed);
+      placer_.Lift(occupied_, placed_begin, &placed_end_);
 
       return num_combinations;
     };
 
-    int num_combinations = 0;
-    if (aircraft_positions.empty()) {
-      AircraftPosition pos;
-      while (workqueue_.Pop(&pos)) {
-        num_combinations +=
-            Process(pos.x, pos.y, pos.dir, num_remaining_known_bodies);
+    int64_t num_combinations = 0;
+    if (num_placed == 0) {
+      PlacementRange range;
+      while (workqueue_.Pop(&range)) {
+        for (int i = range.begin; i < range.end; i++) {
+          const Placement& pos = table_.GetPlacement(i);
+          num_combinations +=
+              Process(pos.x, pos.y, pos.dir, num_remaining_known_bodies);
+        }
       }
     } else {
+      const AircraftPosition& prev = aircraft_positions_[num_placed - 1];
       for (int x = 0; x < r_; x++) {
         for (int y = 0; y < c_; y++) {
-          const AircraftPosition& prev = aircraft_positions.back();
           if (make_pair(x, y) <= make_pair(prev.x, prev.y)) {
             continue;
           }
@@ -198,76 +325,849 @@ class DFSHelper {
     return num_combinations;
   }
 
-  void UpdateHeatmap(const vector<AircraftPosition>& aircraft_positions,
-                     Heatmap& heatmap) const {
-    for (const auto& pos : aircraft_positions) {
+  // Counts the placements of the last aircraft in one pass over the table
+  // instead of trying every cell: it has to come after the previous aircraft,
+  // cover exactly the remaining known bodies and miss every occupied cell.
+  // The placements are credited in bulk once the search is over.
+  int64_t CountLastAircraft(const int num_remaining_known_bodies,
+                            const int num_placed) {
+    const AircraftPosition& prev = aircraft_positions_[num_placed - 1];
+    const vector<int>& candidates =
+        table_.GetPlacementsCoveringKnown(num_remaining_known_bodies);
+    int64_t num_combinations = 0;
+    for (auto i = lower_bound(candidates.begin(), candidates.end(),
+                              table_.FirstAfter(prev.x, prev.y));
+         i != candidates.end(); ++i) {
+      if (!BitsetIntersects(table_.GetFootprint(*i), occupied_bits_,
+                            num_cell_words_)) {
+        last_counts_[*i]++;
+        num_combinations++;
+        if (placement_counts_ != nullptr) {
+          placement_counts_->Add(*i, placement_indices_, num_placed, 1);
+        }
+      }
+    }
+    if (num_combinations > 0) {
+      UpdateHeatmap(num_placed, num_combinations);
+    }
+    return num_combinations;
+  }
+
+  // Credits the first `num_placed` aircrafts with `num_combinations`
+  // configurations.
+  void UpdateHeatmap(const int num_placed, const int64_t num_combinations) {
+    for (int i = 0; i < num_placed; i++) {
+      const AircraftPosition& pos = aircraft_positions_[i];
       for (const pair<int, int>& body : placer_.GetAircraftBody(pos.dir)) {
         const int dx = body.first;
         const int dy = body.second;
         const int x2 = pos.x + dx;
         const int y2 = pos.y + dy;
         if (dx == 0 && dy == 0) {
-          heatmap[x2][y2].red++;
+          heatmap_[x2][y2].red += num_combinations;
         } else {
-          heatmap[x2][y2].blue++;
+          heatmap_[x2][y2].blue += num_combinations;
         }
       }
     }
   }
 
-  const vector<vector<Color>>& board_;
   const int r_;
   const int c_;
+  const SearchSpace& space_;
   const int num_aircrafts_;
+  const PlacementTable& table_;
+  const int num_cell_words_;
 
-  Workqueue& workqueue_;
+  Workqueue<PlacementRange>& workqueue_;
 
   AircraftPlacer placer_;
+
+  char* const occupied_;
+  uint64_t* const occupied_bits_;
+  pair<int, int>* placed_end_;
+  AircraftPosition* const aircraft_positions_;
+  int* const placement_indices_;
+  int64_t* const last_counts_;
+  PlacementCounts* const placement_counts_;
+  Heatmap& heatmap_;
 };
 
-AircraftFinder::AircraftFinder(int r, int c, int num_aircrafts)
-    : r_(r),
-      c_(c),
-      num_aircrafts_(num_aircrafts),
-      board_(r, vector<Color>(c, kGray)) {}
+class CliqueHelper {
+ public:
+  CliqueHelper(const vector<vector<Color>>& board, const SearchSpace& space,
+               const CompatibilityGraph& graph, const int aircraft_size,
+               Workqueue<PlacementRange>& workqueue, const bool count_pairs)
+      : r_(board.size()),
+        c_(board[0].size()),
+        num_aircrafts_(space.num_aircrafts),
+        known_bodies_(space.num_known_bodies),
+        graph_(graph),
+        num_words_(graph.NumWords()),
+        aircraft_size_(aircraft_size),
+        workqueue_(workqueue),
+        count_pairs_(count_pairs),
+        placer_(board) {}
 
-pair<int, int> AircraftFinder::GetCellToBomb(
-    const bool print_entropy_matrix) const {
-  Workqueue workqueue;
-  for (int x = 0; x < r_; x++) {
-    for (int y = 0; y < c_; y++) {
-      for (int dir = 0; dir < 4; dir++) {
-        workqueue.Add(AircraftPosition{x, y, dir});
+  Heatmap ComputeHeatmap() {
+    // candidates_[d] holds the placements compatible with the first d + 1
+    // placements of the current clique.
+    candidates_.resize(num_aircrafts_ * num_words_);
+    clique_.resize(num_aircrafts_);
+    counts_.Reset(graph_.NumPlacements(), count_pairs_);
+
+    int64_t num_combinations = 0;
+    PlacementRange range;
+    while (workqueue_.Pop(&range)) {
+      for (int i = range.begin; i < range.end; i++) {
+        const int num_remaining_known_bodies =
+            known_bodies_ - graph_.GetPlacement(i).num_known;
+        int64_t num_completions = 0;
+        clique_[0] = i;
+        if (num_aircrafts_ == 1) {
+          num_completions = (num_remaining_known_bodies == 0);
+        } else {
+          num_completions =
+              Extend(1, graph_.GetCompatible(i), num_remaining_known_bodies);
+        }
+        counts_.single[i] += num_completions;
+        num_combinations += num_completions;
+      }
+    }
+
+    Heatmap heatmap(r_, c_);
+    for (int i = 0, n = graph_.NumPlacements(); i < n; i++) {
+      const int64_t count = counts_.single[i];
+      if (count == 0) {
+        continue;
+      }
+      const Placement& pos = graph_.GetPlacement(i);
+      for (const pair<int, int>& body : placer_.GetAircraftBody(pos.dir)) {
+        const int dx = body.first;
+        const int dy = body.second;
+        if (dx == 0 && dy == 0) {
+          heatmap[pos.x + dx][pos.y + dy].red += count;
+        } else {
+          heatmap[pos.x + dx][pos.y + dy].blue += count;
+        }
+      }
+    }
+    for (int x = 0; x < r_; x++) {
+      for (int y = 0; y < c_; y++) {
+        heatmap[x][y].white =
+            num_combinations - heatmap[x][y].red - heatmap[x][y].blue;
+      }
+    }
+    return heatmap;
+  }
+
+  const PlacementCounts& GetPlacementCounts() const { return counts_; }
+
+ private:
+  // Counts the ways to complete a clique of `num_placed` placements whose
+  // common neighbors are `candidates`, and credits every placement on the
+  // way with the completions it takes part in.
+  int64_t Extend(const int num_placed, const uint64_t* candidates,
+                 const int num_remaining_known_bodies) {
+    const int num_remaining_aircrafts = num_aircrafts_ - num_placed;
+    if (num_remaining_aircrafts * aircraft_size_ < num_remaining_known_bodies) {
+      return 0;
+    }
+
+    uint64_t* next = &candidates_[num_placed * num_words_];
+    int64_t num_combinations = 0;
+    if (num_remaining_aircrafts == 1) {
+      // The last aircraft has to cover every remaining known body.
+      if (!BitsetAnd(candidates,
+                     graph_.GetPlacementsCoveringKnown(
+                         num_remaining_known_bodies),
+                     next, num_words_)) {
+        return 0;
+      }
+      BitsetForEach(next, num_words_, [this, num_placed,
+                                       &num_combinations](int j) {
+        if (count_pairs_) {
+          counts_.Add(j, clique_.data(), num_placed, 1);
+        } else {
+          counts_.single[j]++;
+        }
+        num_combinations++;
+      });
+      return num_combinations;
+    }
+
+    BitsetForEach(candidates, num_words_, [&](int i) {
+      if (!BitsetAnd(candidates, graph_.GetCompatible(i), next, num_words_)) {
+        return;
+      }
+      clique_[num_placed] = i;
+      const int64_t num_completions =
+          Extend(num_placed + 1, next,
+                 num_remaining_known_bodies - graph_.GetPlacement(i).num_known);
+      if (count_pairs_) {
+        counts_.Add(i, clique_.data(), num_placed, num_completions);
+      } else {
+        counts_.single[i] += num_completions;
+      }
+      num_combinations += num_completions;
+    });
+    return num_combinations;
+  }
+
+  const int r_;
+  const int c_;
+  const int num_aircrafts_;
+  const int known_bodies_;
+  const CompatibilityGraph& graph_;
+  const int num_words_;
+  const int aircraft_size_;
+
+  Workqueue<PlacementRange>& workqueue_;
+  const bool count_pairs_;
+
+  AircraftPlacer placer_;
+
+  vector<uint64_t> candidates_;
+  // The placements of the current clique.
+  vector<int> clique_;
+  PlacementCounts counts_;
+};
+
+// Joint colors of pairs of cells over the configurations, worked out from how
+// often placements appear together.
+class CellPairStatistics {
+ public:
+  CellPairStatistics(const int r, const int c)
+      : c_(c), covering_(r * c) {}
+
+  void Init(const PlacementTable& table, const AircraftPlacer& placer,
+            PlacementCounts counts) {
+    for (int i = 0, n = table.NumPlacements(); i < n; i++) {
+      const Placement& pos = table.GetPlacement(i);
+      for (const pair<int, int>& body : placer.GetAircraftBody(pos.dir)) {
+        covering_[(pos.x + body.first) * c_ + pos.y + body.second].push_back(
+            make_pair(i, body.first == 0 && body.second == 0));
+      }
+    }
+    counts_ = move(counts);
+  }
+
+  // Stores in joint[i][j] the number of configurations in which `a` has
+  // color i and `b` color j, with red, blue and white as 0, 1 and 2.
+  void Count(const Heatmap& heatmap, const pair<int, int>& a,
+             const pair<int, int>& b, int64_t joint[3][3]) const {
+    const Frequency& freq_a = heatmap[a.first][a.second];
+    const Frequency& freq_b = heatmap[b.first][b.second];
+    const int64_t colors_a[3] = {freq_a.red, freq_a.blue, freq_a.white};
+    const int64_t colors_b[3] = {freq_b.red, freq_b.blue, freq_b.white};
+    const int64_t total = colors_a[0] + colors_a[1] + colors_a[2];
+    for (int i = 0; i < 3; i++) {
+      fill(joint[i], joint[i] + 3, 0);
+    }
+
+    // A cell that has the same color in every configuration, such as one
+    // taken by a solved aircraft, tells nothing about the other.
+    for (int i = 0; i < 3; i++) {
+      if (colors_a[i] == total) {
+        copy(colors_b, colors_b + 3, joint[i]);
+        return;
+      }
+      if (colors_b[i] == total) {
+        for (int j = 0; j < 3; j++) {
+          joint[j][i] = colors_a[j];
+        }
+        return;
+      }
+    }
+
+    for (const pair<int, bool>& p : covering_[a.first * c_ + a.second]) {
+      for (const pair<int, bool>& q : covering_[b.first * c_ + b.second]) {
+        joint[p.second ? 0 : 1][q.second ? 0 : 1] +=
+            (p.first == q.first ? counts_.single[p.first]
+                                : counts_.Pair(p.first, q.first));
+      }
+    }
+    // White is whatever the marginals leave.
+    for (int i = 0; i < 2; i++) {
+      joint[i][2] = colors_a[i] - joint[i][0] - joint[i][1];
+      joint[2][i] = colors_b[i] - joint[0][i] - joint[1][i];
+    }
+    joint[2][2] =
+        total - colors_a[0] - colors_a[1] - joint[2][0] - joint[2][1];
+  }
+
+ private:
+  const int c_;
+  // For every cell, the placements covering it and whether with their head.
+  vector<vector<pair<int, bool>>> covering_;
+  PlacementCounts counts_;
+};
+
+namespace {
+
+// Returns whether `num_aircrafts` more aircrafts can land next to the
+// `occupied` cells so that every red or blue cell is covered. Aircrafts left
+// over once everything is covered are assumed to fit somewhere, so this may
+// accept a board that has no configuration but never rejects one that has.
+bool CanCoverKnownBodies(const vector<vector<Color>>& board,
+                         const AircraftPlacer& placer, const int num_aircrafts,
+                         vector<vector<bool>>* occupied) {
+  const int r = board.size();
+  const int c = board[0].size();
+  int num_known_bodies = 0;
+  int first_x = -1;
+  int first_y = -1;
+  for (int x = 0; x < r; x++) {
+    for (int y = 0; y < c; y++) {
+      if ((board[x][y] == kBlue || board[x][y] == kRed) &&
+          !(*occupied)[x][y]) {
+        if (num_known_bodies == 0) {
+          first_x = x;
+          first_y = y;
+        }
+        num_known_bodies++;
+      }
+    }
+  }
+  if (num_known_bodies == 0) {
+    return true;
+  }
+  if (num_aircrafts * placer.AircraftSize() < num_known_bodies) {
+    return false;
+  }
+
+  // Some aircraft has to cover the first known body.
+  vector<pair<int, int>> placed;
+  placed.reserve(placer.AircraftSize());
+  for (int dir = 0; dir < 4; dir++) {
+    for (const pair<int, int>& body : placer.GetAircraftBody(dir)) {
+      const int x = first_x - body.first;
+      const int y = first_y - body.second;
+      bool covered = false;
+      if (placer.TryLand(x, y, dir, occupied, &placed)) {
+        covered =
+            CanCoverKnownBodies(board, placer, num_aircrafts - 1, occupied);
+      }
+      placer.Lift(occupied, &placed);
+      if (covered) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+SearchSpace BuildSearchSpace(const vector<vector<Color>>& board,
+                             const int num_aircrafts) {
+  const int r = board.size();
+  const int c = board[0].size();
+  AircraftPlacer placer(board);
+
+  SearchSpace space;
+  space.occupied.assign(r, vector<bool>(c));
+
+  // A red cell is the head of exactly one aircraft. When the blue cells and
+  // the aircrafts solved so far leave it only one orientation, that aircraft
+  // is in every configuration. Fixing it may pin down others, so iterate
+  // until nothing changes.
+  vector<vector<bool>> is_solved_head(r, vector<bool>(c));
+  vector<pair<int, int>> placed;
+  placed.reserve(placer.AircraftSize());
+  bool changed = true;
+  while (changed && (int)space.solved.size() < num_aircrafts) {
+    changed = false;
+    for (int x = 0; x < r; x++) {
+      for (int y = 0; y < c; y++) {
+        if (board[x][y] != kRed || is_solved_head[x][y]) {
+          continue;
+        }
+        int num_dirs = 0;
+        int only_dir = -1;
+        for (int dir = 0; dir < 4; dir++) {
+          if (placer.TryLand(x, y, dir, &space.occupied, &placed) &&
+              CanCoverKnownBodies(
+                  board, placer,
+                  num_aircrafts - (int)space.solved.size() - 1,
+                  &space.occupied)) {
+            num_dirs++;
+            only_dir = dir;
+          }
+          placer.Lift(&space.occupied, &placed);
+        }
+        if (num_dirs != 1 || (int)space.solved.size() >= num_aircrafts) {
+          continue;
+        }
+        placer.TryLand(x, y, only_dir, &space.occupied, &placed);
+        placed.clear();
+        space.solved.push_back(AircraftPosition{x, y, only_dir});
+        is_solved_head[x][y] = true;
+        changed = true;
       }
     }
   }
 
-  const int num_threads = thread::hardware_concurrency();
+  space.num_aircrafts = num_aircrafts - space.solved.size();
+  space.num_known_bodies = 0;
+  for (int x = 0; x < r; x++) {
+    for (int y = 0; y < c; y++) {
+      space.num_known_bodies +=
+          ((board[x][y] == kBlue || board[x][y] == kRed) &&
+           !space.occupied[x][y]);
+    }
+  }
+  return space;
+}
+
+// Estimates the size of the search and picks how to run it. Every node of
+// the search is a set of pairwise compatible placements, so they are counted
+// as the cliques of a random graph whose edge density is the fraction of
+// placement pairs that do not overlap. Known bodies prune the search further,
+// so this errs on the high side.
+ExecutionPlan PlanExecution(const PlacementTable& table,
+                            const int num_aircrafts, const int max_threads) {
+  // A node takes some 20-40ns, so below this many nodes starting threads
+  // costs more than the search.
+  constexpr double kMinNodesToSpawn = 1 << 14;
+  // Each extra thread has to get at least this much work.
+  constexpr double kMinNodesPerThread = 1 << 14;
+  // Work items per thread, so that uneven subtrees even out.
+  constexpr int kItemsPerThread = 16;
+
+  // Counts the overlapping pairs through the placements covering each cell.
+  const int n = table.NumPlacements();
+  const int num_words = table.NumPlacementWords();
+  double num_overlapping = 0.0;
+  vector<uint64_t> overlapping(num_words);
+  for (int i = 0; i < n; i++) {
+    table.GetOverlapping(i, overlapping.data());
+    num_overlapping += BitsetCount(overlapping.data(), num_words) - 1;
+  }
+  const double compatible =
+      n > 1 ? 1.0 - num_overlapping / n / (n - 1) : 1.0;
+
+  ExecutionPlan plan;
+  plan.num_placements = n;
+  plan.num_aircrafts = num_aircrafts;
+  plan.estimated_nodes = 0.0;
+  // Sets of k placements, times the odds that their k * (k - 1) / 2 pairs
+  // are all compatible.
+  double num_sets = 1.0;
+  for (int k = 1; k <= num_aircrafts; k++) {
+    num_sets *= static_cast<double>(n - k + 1) / k * pow(compatible, k - 1);
+    plan.estimated_nodes += num_sets;
+  }
+
+  plan.num_threads =
+      plan.estimated_nodes < kMinNodesToSpawn
+          ? 1
+          : static_cast<int>(min<double>(
+                max_threads, plan.estimated_nodes / kMinNodesPerThread));
+  // A single worker gains nothing from a thread of its own.
+  plan.inline_on_caller = plan.num_threads <= 1;
+  if (plan.inline_on_caller) {
+    plan.num_threads = 1;
+    plan.batch_size = max(n, 1);
+  } else {
+    plan.batch_size = max(1, n / (plan.num_threads * kItemsPerThread));
+  }
+  return plan;
+}
+
+void AddPlacementRanges(const int num_placements, const int batch_size,
+                        Workqueue<PlacementRange>* workqueue) {
+  for (int begin = 0; begin < num_placements; begin += batch_size) {
+    workqueue->Add(
+        PlacementRange{begin, min(begin + batch_size, num_placements)});
+  }
+}
+
+// Inline plans run the only worker on the calling thread when its result is
+// asked for.
+launch LaunchPolicy(const ExecutionPlan& plan) {
+  return plan.inline_on_caller ? launch::deferred : launch::async;
+}
+
+Heatmap ComputeHeatmapByDFS(const vector<vector<Color>>& board,
+                            const SearchSpace& space,
+                            const PlacementTable& table,
+                            const ExecutionPlan& plan,
+                            vector<unique_ptr<DFSArena>>& arenas,
+                            PlacementCounts* placement_counts) {
+  const int r = board.size();
+  const int c = board[0].size();
+  Workqueue<PlacementRange> workqueue;
+  AddPlacementRanges(table.NumPlacements(), plan.batch_size, &workqueue);
+
+  const int num_threads = plan.num_threads;
   vector<unique_ptr<DFSHelper>> workers;
   workers.reserve(num_threads);
+  vector<future<void>> done_per_worker;
+  done_per_worker.reserve(num_threads);
+  // Only the workers that run keep a table of pairs, and only for salvos.
+  for (int i = 0, n = arenas.size(); i < n; i++) {
+    if (placement_counts != nullptr && i < num_threads) {
+      arenas[i]->placement_counts.Reset(table.NumPlacements(), true);
+    } else {
+      arenas[i]->placement_counts = PlacementCounts();
+    }
+  }
+  for (int i = 0; i < num_threads; i++) {
+    auto helper = make_unique<DFSHelper>(board, space, table, workqueue,
+                                         *arenas[i],
+                                         placement_counts != nullptr);
+    done_per_worker.push_back(
+        async(LaunchPolicy(plan), &DFSHelper::ComputeHeatmap, helper.get()));
+    workers.push_back(move(helper));
+  }
+
+  Heatmap heatmap(r, c);
+  for (int i = 0; i < num_threads; i++) {
+    done_per_worker[i].get();
+    heatmap += arenas[i]->heatmap;
+    if (placement_counts != nullptr) {
+      *placement_counts += arenas[i]->placement_counts;
+    }
+  }
+  return heatmap;
+}
+
+Heatmap ComputeHeatmapByCliques(const vector<vector<Color>>& board,
+                                const SearchSpace& space,
+                                const PlacementTable& table,
+                                const ExecutionPlan& plan,
+                                PlacementCounts* placement_counts) {
+  const int r = board.size();
+  const int c = board[0].size();
+  CompatibilityGraph graph(table);
+  Workqueue<PlacementRange> workqueue;
+  AddPlacementRanges(graph.NumPlacements(), plan.batch_size, &workqueue);
+
+  const int num_threads = plan.num_threads;
+  vector<unique_ptr<CliqueHelper>> workers;
+  workers.reserve(num_threads);
   vector<future<Heatmap>> heatmap_per_worker;
   heatmap_per_worker.reserve(num_threads);
   for (int i = 0; i < num_threads; i++) {
-    auto helper = make_unique<DFSHelper>(board_, num_aircrafts_, workqueue);
-    heatmap_per_worker.push_back(
-        async(launch::async, &DFSHelper::ComputeHeatmap, helper.get()));
+    auto helper = make_unique<CliqueHelper>(
+        board, space, graph, table.AircraftSize(), workqueue,
+        placement_counts != nullptr);
+    heatmap_per_worker.push_back(async(
+        LaunchPolicy(plan), &CliqueHelper::ComputeHeatmap, helper.get()));
     workers.push_back(move(helper));
   }
 
-  Heatmap heatmap(r_, c_);
+  Heatmap heatmap(r, c);
   for (int i = 0; i < num_threads; i++) {
     heatmap += heatmap_per_worker[i].get();
+    if (placement_counts != nullptr) {
+      *placement_counts += workers[i]->GetPlacementCounts();
+    }
+  }
+  return heatmap;
+}
+
+void CollectCliques(const CompatibilityGraph& graph, const uint64_t* candidates,
+                    const int num_remaining_aircrafts,
+                    const int num_remaining_known_bodies,
+                    const int aircraft_size, vector<int>* clique,
+                    vector<vector<int>>* cliques) {
+  if (num_remaining_aircrafts * aircraft_size < num_remaining_known_bodies) {
+    return;
+  }
+  if (num_remaining_aircrafts == 0) {
+    if (num_remaining_known_bodies == 0) {
+      cliques->push_back(*clique);
+    }
+    return;
+  }
+
+  const int num_words = graph.NumWords();
+  vector<uint64_t> next(num_words);
+  BitsetForEach(candidates, num_words, [&](int i) {
+    if (num_remaining_aircrafts > 1 &&
+        !BitsetAnd(candidates, graph.GetCompatible(i), next.data(),
+                   num_words)) {
+      return;
+    }
+    clique->push_back(i);
+    CollectCliques(graph, next.data(), num_remaining_aircrafts - 1,
+                   num_remaining_known_bodies - graph.GetPlacement(i).num_known,
+                   aircraft_size, clique, cliques);
+    clique->pop_back();
+  });
+}
+
+// Lists every configuration consistent with the board as the color of each
+// cell in row-major order.
+vector<vector<Color>> EnumerateConfigurations(
+    const vector<vector<Color>>& board, const SearchSpace& space) {
+  const int r = board.size();
+  const int c = board[0].size();
+  AircraftPlacer placer(board);
+  const PlacementTable table(board, placer, space.occupied);
+  CompatibilityGraph graph(table);
+
+  vector<vector<int>> cliques;
+  vector<int> clique;
+  vector<uint64_t> all(graph.NumWords());
+  for (int i = 0, n = graph.NumPlacements(); i < n; i++) {
+    BitsetSet(all.data(), i);
+  }
+  CollectCliques(graph, all.data(), space.num_aircrafts,
+                 space.num_known_bodies, placer.AircraftSize(), &clique,
+                 &cliques);
+
+  auto Paint = [&placer, c](const AircraftPosition& pos,
+                            vector<Color>* colors) {
+    for (const pair<int, int>& body : placer.GetAircraftBody(pos.dir)) {
+      (*colors)[(pos.x + body.first) * c + pos.y + body.second] =
+          (body.first == 0 && body.second == 0 ? kRed : kBlue);
+    }
+  };
+
+  vector<Color> solved_colors(r * c, kWhite);
+  for (const AircraftPosition& pos : space.solved) {
+    Paint(pos, &solved_colors);
+  }
+  vector<vector<Color>> configurations;
+  configurations.reserve(cliques.size());
+  for (const vector<int>& placements : cliques) {
+    vector<Color> colors = solved_colors;
+    for (const int i : placements) {
+      const Placement& p = graph.GetPlacement(i);
+      Paint(AircraftPosition{p.x, p.y, p.dir}, &colors);
+    }
+    configurations.push_back(move(colors));
+  }
+  return configurations;
+}
+
+Heatmap ComputeHeatmap(
+    const vector<vector<Color>>& board, const SearchSpace& space,
+    const Engine engine, vector<unique_ptr<DFSArena>>& arenas,
+    const function<void(const ExecutionPlan&)>& stats_hook,
+    CellPairStatistics* pair_statistics) {
+  const int r = board.size();
+  const int c = board[0].size();
+  AircraftPlacer placer(board);
+
+  Heatmap heatmap(r, c);
+  if (space.num_aircrafts == 0) {
+    // Every aircraft is solved, so at most one configuration is left.
+    const int64_t num_combinations = (space.num_known_bodies == 0);
+    for (int x = 0; x < r; x++) {
+      for (int y = 0; y < c; y++) {
+        heatmap[x][y].white = num_combinations;
+      }
+    }
+  } else {
+    const PlacementTable table(board, placer, space.occupied);
+    const ExecutionPlan plan =
+        PlanExecution(table, space.num_aircrafts, arenas.size());
+    if (stats_hook) {
+      stats_hook(plan);
+    }
+    PlacementCounts placement_counts;
+    if (pair_statistics != nullptr) {
+      placement_counts.Reset(table.NumPlacements(), true);
+    }
+    PlacementCounts* counts =
+        (pair_statistics != nullptr ? &placement_counts : nullptr);
+    if (engine == kCompatibilityGraphEngine) {
+      heatmap += ComputeHeatmapByCliques(board, space, table, plan, counts);
+    } else {
+      heatmap +=
+          ComputeHeatmapByDFS(board, space, table, plan, arenas, counts);
+    }
+    if (pair_statistics != nullptr) {
+      pair_statistics->Init(table, placer, move(placement_counts));
+    }
   }
 
-  vector<vector<Probability>> normalized_heatmap;
-  normalized_heatmap.resize(r_);
+  // The solved aircrafts take the same cells in every configuration.
+  const Frequency& any = heatmap[0][0];
+  const int64_t num_combinations = any.red + any.blue + any.white;
+  for (const AircraftPosition& pos : space.solved) {
+    for (const pair<int, int>& body : placer.GetAircraftBody(pos.dir)) {
+      Frequency& freq = heatmap[pos.x + body.first][pos.y + body.second];
+      if (body.first == 0 && body.second == 0) {
+        freq.red += num_combinations;
+      } else {
+        freq.blue += num_combinations;
+      }
+      freq.white -= num_combinations;
+    }
+  }
+  return heatmap;
+}
+
+double Entropy(const int64_t* counts, const int n) {
+  int64_t total = 0;
+  for (int i = 0; i < n; i++) {
+    total += counts[i];
+  }
+  double entropy = 0.0;
+  for (int i = 0; i < n; i++) {
+    if (counts[i] > 0) {
+      const double p = static_cast<double>(counts[i]) / total;
+      entropy -= log(p) * p;
+    }
+  }
+  return entropy;
+}
+
+// Adds gray cells to `cells` until it holds `num_cells` of them, each time the
+// one whose color is the hardest to predict from the color of any single
+// cell picked so far. The cells already in `cells` are kept as they are, so
+// for two cells this maximizes the entropy of their joint colors only given
+// the first pick. Beyond two, each next cell maximizes an upper bound of the
+// entropy it adds to the cells picked before it.
+void PickSalvo(const vector<vector<Color>>& board, const Heatmap& heatmap,
+               const CellPairStatistics& pair_statistics, const int num_cells,
+               vector<pair<int, int>>* cells) {
+  const int r = board.size();
+  const int c = board[0].size();
+  // For every cell, the least entropy of its color given the color of a
+  // picked cell.
+  vector<vector<double>> entropy(r, vector<double>(c));
+  for (int x = 0; x < r; x++) {
+    for (int y = 0; y < c; y++) {
+      entropy[x][y] = Probability(heatmap[x][y]).Entropy();
+    }
+  }
+
+  for (int k = 0, n = cells->size(); k < n; k++) {
+    entropy[(*cells)[k].first][(*cells)[k].second] = -1.0;
+  }
+  while ((int)cells->size() < num_cells) {
+    const pair<int, int> last = cells->back();
+    const Frequency& last_freq = heatmap[last.first][last.second];
+    const int64_t last_colors[3] = {last_freq.red, last_freq.blue,
+                                    last_freq.white};
+    const double last_entropy = Entropy(last_colors, 3);
+
+    pair<int, int> best(-1, -1);
+    double best_entropy = -1.0;
+    double best_red = -1.0;
+    for (int x = 0; x < r; x++) {
+      for (int y = 0; y < c; y++) {
+        if (board[x][y] != kGray || entropy[x][y] < 0.0) {
+          continue;
+        }
+        int64_t joint[3][3];
+        pair_statistics.Count(heatmap, last, make_pair(x, y), joint);
+        entropy[x][y] =
+            min(entropy[x][y], Entropy(&joint[0][0], 9) - last_entropy);
+        const double red = Probability(heatmap[x][y]).Red();
+        if (entropy[x][y] > best_entropy ||
+            (entropy[x][y] == best_entropy && red > best_red)) {
+          best = make_pair(x, y);
+          best_entropy = entropy[x][y];
+          best_red = red;
+        }
+      }
+    }
+    if (best.first < 0) {
+      break;
+    }
+    cells->push_back(best);
+    entropy[best.first][best.second] = -1.0;
+  }
+}
+
+// Returns the gray cell whose color is expected to rule out the most
+// configurations, or (-1, -1) if every color is known. When n of the N
+// configurations give a color, seeing it leaves n of them, so N - sum(n^2) / N
+// are expected to go.
+pair<int, int> PickByCount(const vector<vector<Color>>& board,
+                           const Heatmap& heatmap) {
+  const int r = board.size();
+  const int c = board[0].size();
+  pair<int, int> best(-1, -1);
+  double best_value = 0.0;
+  double best_red = -1.0;
+  for (int x = 0; x < r; x++) {
+    for (int y = 0; y < c; y++) {
+      if (board[x][y] != kGray) {
+        continue;
+      }
+      const Frequency& freq = heatmap[x][y];
+      const int64_t colors[3] = {freq.red, freq.blue, freq.white};
+      const int64_t total = colors[0] + colors[1] + colors[2];
+      double value = total;
+      for (int i = 0; i < 3; i++) {
+        value -= static_cast<double>(colors[i]) * colors[i] / total;
+      }
+      const double red = static_cast<double>(freq.red) / total;
+      if (value > best_value || (value == best_value && red > best_red)) {
+        best = make_pair(x, y);
+        best_value = value;
+        best_red = red;
+      }
+    }
+  }
+  return best;
+}
+
+}  // namespace
+
+AircraftFinder::AircraftFinder(int r, int c, int num_aircrafts)
+    : r_(r),
+      c_(c),
+      num_aircrafts_(num_aircrafts),
+      board_(r, vector<Color>(c, kGray)) {
+  const int aircraft_size = AircraftPlacer(board_).AircraftSize();
+  // hardware_concurrency may return 0 when it cannot tell.
+  const int num_threads = max(1u, thread::hardware_concurrency());
+  for (int i = 0; i < num_threads; i++) {
+    dfs_arenas_.push_back(
+        make_unique<DFSArena>(r_, c_, num_aircrafts_, aircraft_size));
+  }
+}
+
+AircraftFinder::~AircraftFinder() {}
+
+void AircraftFinder::SetColor(const int x, const int y, const Color color) {
+  board_[x][y] = color;
+  space_.reset();
+}
+
+pair<int, int> AircraftFinder::GetCellToBomb(
+    const bool print_entropy_matrix) {
+  return GetCellsToBomb(1, print_entropy_matrix)[0];
+}
+
+vector<pair<int, int>> AircraftFinder::GetCellsToBomb(
+    const int num_cells, const bool print_entropy_matrix) {
+  DecisionBuffer decision;
+  Analyze(num_cells, &decision);
+  if (print_entropy_matrix) {
+    decision.PrintEntropyMatrix();
+  }
+
+  vector<pair<int, int>> cells;
+  for (int i = 0; i < decision.GetHeader().num_picked; i++) {
+    const int index = decision.GetPicked()[i];
+    cells.push_back(make_pair(index / c_, index % c_));
+  }
+  return cells;
+}
+
+void AircraftFinder::Analyze(const int num_cells,
+                             DecisionBuffer* decision) {
+  if (space_ == nullptr) {
+    space_ = make_unique<SearchSpace>(BuildSearchSpace(board_, num_aircrafts_));
+  }
+  CellPairStatistics pair_statistics(r_, c_);
+  const Heatmap heatmap =
+      ComputeHeatmap(board_, *space_, engine_, dfs_arenas_, stats_hook_,
+                     num_cells > 1 ? &pair_statistics : nullptr);
+
   vector<CellProbability> cell_probabilities;
   for (int x = 0; x < r_; x++) {
-    normalized_heatmap.reserve(c_);
     for (int y = 0; y < c_; y++) {
-      Probability prob(heatmap[x][y]);
-      normalized_heatmap[x].push_back(prob);
-      cell_probabilities.push_back(CellProbability{x, y, prob});
+      cell_probabilities.push_back(
+          CellProbability{x, y, Probability(heatmap[x][y])});
     }
   }
 
@@ -279,8 +1179,17 @@ pair<int, int> AircraftFinder::GetCellToBomb(
       top_cell = make_pair(p.x, p.y);
     }
   }
+  const Frequency& any = heatmap[0][0];
+  const bool solved_endgame =
+      max_red < 1.0 &&
+      SolveEndgame(any.red + any.blue + any.white, &top_cell);
   constexpr double kThresholdMustBomb = 0.5;
-  if (max_red < kThresholdMustBomb) {
+  if (!solved_endgame && max_red < kThresholdMustBomb &&
+      scoring_policy_ == kCountPolicy) {
+    top_cell = PickByCount(board_, heatmap);
+  }
+  if (!solved_endgame && max_red < kThresholdMustBomb &&
+      (scoring_policy_ == kEntropyPolicy || top_cell.first < 0)) {
     sort(cell_probabilities.begin(), cell_probabilities.end(),
          [this](const CellProbability& p1, const CellProbability& p2) {
            // Pick the cell with a larger entropy.
@@ -303,44 +1212,98 @@ pair<int, int> AircraftFinder::GetCellToBomb(
     top_cell = make_pair(cell_probabilities[0].x, cell_probabilities[0].y);
   }
 
-  if (print_entropy_matrix) {
-    printf("  ");
+  vector<pair<int, int>> cells;
+  if (num_cells > 0) {
+    cells.push_back(top_cell);
+  }
+  if (num_cells > 1) {
+    PickSalvo(board_, heatmap, pair_statistics, num_cells, &cells);
+  }
+
+  decision->Reset(r_, c_);
+  DecisionHeader& header = decision->GetHeader();
+  header.num_configurations = any.red + any.blue + any.white;
+  DecisionCell* decision_cells = decision->GetCells();
+  for (int x = 0; x < r_; x++) {
     for (int y = 0; y < c_; y++) {
-      printf("%6c", 'A' + y);
-    }
-    printf("\n");
-    for (int x = 0; x < r_; x++) {
-      printf("%2d: ", x + 1);
-      for (int y = 0; y < c_; y++) {
-        PrintCell(normalized_heatmap[x][y], make_pair(x, y) == top_cell,
-                  board_[x][y] != kGray);
-      }
-      printf("\n");
+      const Frequency& freq = heatmap[x][y];
+      const Probability prob(freq);
+      DecisionCell& cell = decision_cells[x * c_ + y];
+      cell.red = freq.red;
+      cell.blue = freq.blue;
+      cell.white = freq.white;
+      cell.p_red = prob.Red();
+      cell.p_blue = prob.Blue();
+      cell.p_white = prob.White();
+      cell.entropy = prob.Entropy();
+      cell.x = x;
+      cell.y = y;
+      cell.color = board_[x][y];
     }
   }
 
-  return top_cell;
+  // The picked cells come first in the ranking, then the other gray cells
+  // by the entropy rule.
+  int32_t* picked = decision->GetPicked();
+  int32_t* ranked = decision->GetRanked();
+  for (const pair<int, int>& cell : cells) {
+    const int index = cell.first * c_ + cell.second;
+    decision_cells[index].is_picked = 1;
+    picked[header.num_picked++] = index;
+    ranked[header.num_ranked++] = index;
+  }
+  int32_t* others = ranked + header.num_ranked;
+  for (int index = 0; index < r_ * c_; index++) {
+    const DecisionCell& cell = decision_cells[index];
+    if (static_cast<Color>(cell.color) == kGray && !cell.is_picked) {
+      ranked[header.num_ranked++] = index;
+    }
+  }
+  stable_sort(others, ranked + header.num_ranked,
+              [decision_cells](const int32_t i, const int32_t j) {
+                const DecisionCell& a = decision_cells[i];
+                const DecisionCell& b = decision_cells[j];
+                if (a.entropy != b.entropy) {
+                  return a.entropy > b.entropy;
+                }
+                return a.p_red > b.p_red;
+              });
 }
 
-void AircraftFinder::PrintCell(const Probability& p, const bool is_top,
-                               const bool is_known) const {
-  double max_probability = max(p.Red(), max(p.Blue(), p.White()));
-  int color_code;
-  if (p.Red() == max_probability) {
-    color_code = 31;
-  } else if (p.Blue() == max_probability) {
-    color_code = 34;
-  } else {
-    color_code = 30;
+bool AircraftFinder::SolveEndgame(const int64_t num_combinations,
+                                  pair<int, int>* cell) {
+  if (num_combinations == 0 || num_combinations > endgame_threshold_) {
+    return false;
+  }
+  vector<Color> board;
+  board.reserve(r_ * c_);
+  for (const vector<Color>& row : board_) {
+    board.insert(board.end(), row.begin(), row.end());
   }
 
-  int style_code = 0;
-  if (is_top) {
-    style_code = 1;
-  } else if (is_known) {
-    style_code = 9;
+  // The configurations listed for an earlier board still hold every one of
+  // this board as long as no color seen then has changed since.
+  bool is_refinement = (endgame_solver_ != nullptr);
+  for (int i = 0, n = endgame_board_.size(); i < n && is_refinement; i++) {
+    is_refinement =
+        (endgame_board_[i] == kGray || endgame_board_[i] == board[i]);
   }
-  printf("\033[%d;%dm", style_code, color_code);
-  printf("%5.1f ", p.Entropy() * 100);
-  printf("\33[0m");
+  if (!is_refinement) {
+    endgame_solver_ = make_unique<EndgameSolver>(
+        EnumerateConfigurations(board_, *space_), num_aircrafts_);
+    endgame_board_ = board;
+  }
+  int index;
+  if (!endgame_solver_->Solve(board, endgame_budget_, &index)) {
+    return false;
+  }
+  *cell = make_pair(index / c_, index % c_);
+  return true;
 }
+
+vector<AircraftPosition> AircraftFinder::GetSolvedAircrafts() const {
+  if (space_ != nullptr) {
+    return space_->solved;
+  }
+  return BuildSearchSpace(board_, num_aircrafts_).solved;
+}
\ No newline at end of file
@@ -1,14 +1,20 @@
 #ifndef __AIRCRAFT_FINDER_H
 #define __AIRCRAFT_FINDER_H
 
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <vector>
 
 #include "color.h"
+#include "decision_buffer.h"
 
+// Configuration counts overflow 32 bits on large boards.
 struct Frequency {
-  int red = 0;
-  int blue = 0;
-  int white = 0;
+  int64_t red = 0;
+  int64_t blue = 0;
+  int64_t white = 0;
 };
 
 class Probability {
@@ -28,22 +34,134 @@ class Probability {
   double white_;
 };
 
+// The color seen at (x, y).
+struct Observation {
+  int x;
+  int y;
+  Color color;
+};
+
+struct AircraftPosition {
+  int x;
+  int y;
+  int dir;
+};
+
+enum Engine {
+  // Lands aircrafts one at a time, checking each cell with TryLand.
+  kDFSEngine,
+  // Enumerates cliques of the compatibility graph of legal placements.
+  kCompatibilityGraphEngine,
+};
+
+// How GetCellToBomb picks among cells that are unlikely to be heads. The
+// entropy rule, the default, needs the fewest guesses in accuracy_benchmark
+// on 12x12 boards with 3 aircrafts; the other is kept to compare against.
+enum ScoringPolicy {
+  // Picks the cell whose color is the least predictable.
+  kEntropyPolicy,
+  // Picks the cell whose color is expected to rule out the most
+  // configurations.
+  kCountPolicy,
+};
+
+// How one enumeration is run, chosen from a cheap estimate of its size.
+struct ExecutionPlan {
+  // Legal placements of a single aircraft, and aircrafts left to place.
+  int num_placements;
+  int num_aircrafts;
+  // Estimated number of partial fleets the search visits.
+  double estimated_nodes;
+  int num_threads;
+  // Number of placements of the first aircraft in each work item.
+  int batch_size;
+  // Whether the search runs on the calling thread instead of on workers.
+  bool inline_on_caller;
+};
+
+class DFSArena;
+class EndgameSolver;
+struct SearchSpace;
+
+// GetCellToBomb reuses scratch memory owned by the finder, so it is not const
+// and a finder must not be queried from several threads at once.
 class AircraftFinder {
  public:
   AircraftFinder(int r, int c, int num_aircrafts);
+  ~AircraftFinder();
+
+  void SetColor(int x, int y, Color color);
+
+  // Records the colors seen by a salvo. Nothing is recomputed until the next
+  // GetCellToBomb or GetCellsToBomb.
+  void SetColors(const std::vector<Observation>& observations) {
+    for (const Observation& o : observations) {
+      SetColor(o.x, o.y, o.color);
+    }
+  }
+
+  void SetEngine(Engine engine) { engine_ = engine; }
+
+  void SetScoringPolicy(ScoringPolicy policy) { scoring_policy_ = policy; }
+
+  // Once at most `threshold` configurations are left, GetCellToBomb searches
+  // for the guess that minimizes the expected number of remaining guesses.
+  // A threshold of 0 disables the search.
+  void SetEndgameThreshold(int threshold) { endgame_threshold_ = threshold; }
+
+  // The endgame search falls back to the entropy heuristic when it takes
+  // longer than `budget`.
+  void SetEndgameBudget(std::chrono::milliseconds budget) {
+    endgame_budget_ = budget;
+  }
+
+  // Called with the plan of every enumeration GetCellToBomb runs.
+  void SetStatsHook(std::function<void(const ExecutionPlan&)> hook) {
+    stats_hook_ = hook;
+  }
+
+  std::pair<int, int> GetCellToBomb(const bool print_entropy_matrix);
+
+  // Picks `num_cells` cells to bomb at once from a single enumeration. The
+  // first is the one GetCellToBomb would pick, and each next one the gray
+  // cell that the cells picked so far predict the least. The picks are
+  // greedy, so even a pair is only the most informative given its first
+  // cell. Returns fewer cells when there are not enough gray cells, and none
+  // when `num_cells` is not positive.
+  std::vector<std::pair<int, int>> GetCellsToBomb(
+      int num_cells, const bool print_entropy_matrix);
 
-  void SetColor(int x, int y, Color color) { board_[x][y] = color; }
+  // Runs one enumeration, picks `num_cells` cells like GetCellsToBomb and
+  // fills `decision` with everything it found, reusing its storage. With a
+  // non-positive `num_cells` nothing is picked and only the cells are ranked.
+  void Analyze(int num_cells, DecisionBuffer* decision);
 
-  std::pair<int, int> GetCellToBomb(const bool print_entropy_matrix) const;
+  // Returns the aircrafts whose placement is forced by the colors seen so
+  // far. The search only enumerates the remaining ones. Reuses what the last
+  // Analyze found when no color changed since.
+  std::vector<AircraftPosition> GetSolvedAircrafts() const;
 
  private:
-  void PrintCell(const Probability& p, const bool is_top,
-                 const bool is_known) const;
+  bool SolveEndgame(int64_t num_combinations, std::pair<int, int>* cell);
 
   const int r_;
   const int c_;
   const int num_aircrafts_;
   std::vector<std::vector<Color>> board_;
+  Engine engine_ = kDFSEngine;
+  ScoringPolicy scoring_policy_ = kEntropyPolicy;
+  int endgame_threshold_ = 16;
+  std::chrono::milliseconds endgame_budget_{50};
+  std::function<void(const ExecutionPlan&)> stats_hook_;
+  // One per DFS worker.
+  std::vector<std::unique_ptr<DFSArena>> dfs_arenas_;
+  // The solved aircrafts of board_, built by the first Analyze after a color
+  // changes.
+  std::unique_ptr<SearchSpace> space_;
+  // Kept across moves with the board its configurations were listed for, so
+  // later moves of the endgame only filter them and reuse the memo.
+  std::unique_ptr<EndgameSolver> endgame_solver_;
+  std::vector<Color> endgame_board_;
 };
 
 #endif
\ No newline at end of file
@@ -2,23 +2,33 @@
 
 #include <iostream>
 #include <sstream>
+#include <string>
 #include <tuple>
+#include <vector>
 
 #include "aircraft_finder.h"
+#include "decision_buffer.h"
 
 using namespace std;
 
 void PrintUsage(const char* exec_name) {
-  cerr << "Usage: " << exec_name << " -r rows -c cols -n aircrafts" << endl;
+  cerr << "Usage: " << exec_name << " -r rows -c cols -n aircrafts"
+       << " [-e dfs|graph] [-k shots]"
+       << " [-p entropy|count] [-v] [-j]" << endl;
 }
 
 int main(int argc, char* argv[]) {
   int rows = 0;
   int cols = 0;
   int num_aircrafts = 0;
+  Engine engine = kDFSEngine;
+  ScoringPolicy scoring_policy = kEntropyPolicy;
+  int num_shots = 1;
+  bool verbose = false;
+  bool json = false;
 
   int opt;
-  while ((opt = getopt(argc, argv, "r:c:n:")) != -1) {
+  while ((opt = getopt(argc, argv, "r:c:n:e:k:vp:j")) != -1) {
     switch (opt) {
       case 'r':
         rows = atoi(optarg);
@@ -29,54 +39,131 @@ int main(int argc, char* argv[]) {
       case 'n':
         num_aircrafts = atoi(optarg);
         break;
+      case 'e':
+        if (string(optarg) == "dfs") {
+          engine = kDFSEngine;
+        } else if (string(optarg) == "graph") {
+          engine = kCompatibilityGraphEngine;
+        } else {
+          PrintUsage(argv[0]);
+          return 1;
+        }
+        break;
+      case 'k':
+        num_shots = atoi(optarg);
+        break;
+      case 'v':
+        verbose = true;
+        break;
+      case 'j':
+        json = true;
+        break;
+      case 'p':
+        if (string(optarg) == "entropy") {
+          scoring_policy = kEntropyPolicy;
+        } else if (string(optarg) == "count") {
+          scoring_policy = kCountPolicy;
+        } else {
+          PrintUsage(argv[0]);
+          return 1;
+        }
+        break;
       default:
         PrintUsage(argv[0]);
         return 1;
     }
   }
 
-  if (rows <= 0 || cols <= 0 || num_aircrafts <= 0) {
+  if (rows <= 0 || cols <= 0 || num_aircrafts <= 0 || num_shots <= 0) {
     PrintUsage(argv[0]);
     return 1;
   }
 
   AircraftFinder finder(rows, cols, num_aircrafts);
+  finder.SetEngine(engine);
+  finder.SetScoringPolicy(scoring_policy);
+  if (verbose) {
+    finder.SetStatsHook([](const ExecutionPlan& plan) {
+      cerr << "Plan: " << plan.num_placements << " placements, "
+           << plan.num_aircrafts << " aircrafts, ~" << plan.estimated_nodes
+           << " nodes -> ";
+      if (plan.inline_on_caller) {
+        cerr << "inline" << endl;
+      } else {
+        cerr << plan.num_threads << " threads, " << plan.batch_size
+             << " placements per item" << endl;
+      }
+    });
+  }
 
+  DecisionBuffer decision;
   int num_remaining_aircrafts = num_aircrafts;
   int num_guesses = 0;
   while (true) {
-    int x;
-    int y;
-    tie(x, y) = finder.GetCellToBomb(true);
+    finder.Analyze(num_shots, &decision);
+    decision.PrintEntropyMatrix();
+    if (json) {
+      decision.WriteJson(cerr);
+      cerr << endl;
+    }
     if (num_remaining_aircrafts <= 0) {
       break;
     }
 
+    vector<pair<int, int>> cells;
+    for (int i = 0; i < decision.GetHeader().num_picked; i++) {
+      const int index = decision.GetPicked()[i];
+      cells.push_back(make_pair(index / cols, index % cols));
+    }
+
+    const vector<AircraftPosition> solved = finder.GetSolvedAircrafts();
+    if (!solved.empty()) {
+      printf("Solved:");
+      for (const AircraftPosition& pos : solved) {
+        printf(" (%d, %c)", pos.x + 1, 'A' + pos.y);
+      }
+      printf("\n");
+    }
+
     num_guesses++;
-    printf("Guess #%d: (%d, %c) > ", num_guesses, x + 1, 'A' + y);
+    printf("Guess #%d:", num_guesses);
+    for (const pair<int, int>& cell : cells) {
+      printf(" (%d, %c)", cell.first + 1, 'A' + cell.second);
+    }
+    printf(" > ");
 
     string line;
     if (!getline(cin, line)) {
       break;
     }
 
-    char char_c;
+    // The line holds either one color per guessed cell, or any number of
+    // "row col color" entries.
+    vector<Observation> observations;
     istringstream iss(line);
-    iss >> char_c;
-    // If the line contains a color only, reuse the cell to bomb.
-    if (isdigit(char_c)) {
-      iss.str(line);
-
-      char char_y;
-      iss >> x >> char_y >> char_c;
-      x--;
-      y = char_y - (isupper(char_y) ? 'A' : 'a');
+    char char_c;
+    while (iss >> char_c) {
+      int x;
+      int y;
+      if (isdigit(char_c)) {
+        iss.putback(char_c);
+        char char_y;
+        iss >> x >> char_y >> char_c;
+        x--;
+        y = char_y - (isupper(char_y) ? 'A' : 'a');
+      } else if (observations.size() < cells.size()) {
+        tie(x, y) = cells[observations.size()];
+      } else {
+        break;
+      }
+      observations.push_back(Observation{x, y, static_cast<Color>(char_c)});
     }
 
-    Color c = static_cast<Color>(char_c);
-    finder.SetColor(x, y, c);
-    if (c == kRed) {
-      num_remaining_aircrafts--;
+    finder.SetColors(observations);
+    for (const Observation& o : observations) {
+      if (o.color == kRed) {
+        num_remaining_aircrafts--;
+      }
     }
   }
 
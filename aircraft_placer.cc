@@ -51,3 +51,39 @@ void AircraftPlacer::Lift(vector<vector<bool>>* occupied,
     (*occupied)[x][y] = false;
   }
 }
+
+bool AircraftPlacer::TryLand(int x, int y, int dir, char* occupied,
+                             pair<int, int>** placed_end) const {
+  const int r = board_.size();
+  const int c = board_[0].size();
+  for (const pair<int, int>& body : aircraft_bodies_[dir]) {
+    int dx = body.first;
+    int dy = body.second;
+    int x2 = x + dx;
+    int y2 = y + dy;
+    if (x2 < 0 || x2 >= r || y2 < 0 || y2 >= c) {
+      return false;
+    }
+    if (occupied[x2 * c + y2]) {
+      return false;
+    }
+    Color new_color = (dx == 0 && dy == 0 ? kRed : kBlue);
+    if (board_[x2][y2] != kGray) {
+      if (board_[x2][y2] != new_color) {
+        return false;
+      }
+    }
+    occupied[x2 * c + y2] = true;
+    *(*placed_end)++ = {x2, y2};
+  }
+  return true;
+}
+
+void AircraftPlacer::Lift(char* occupied, const pair<int, int>* placed_begin,
+                          pair<int, int>** placed_end) const {
+  const int c = board_[0].size();
+  while (*placed_end != placed_begin) {
+    --*placed_end;
+    occupied[(*placed_end)->first * c + (*placed_end)->second] = false;
+  }
+}
\ No newline at end of file
@@ -15,6 +15,15 @@ class AircraftPlacer {
   void Lift(std::vector<std::vector<bool>>* occupied,
             std::vector<std::pair<int, int>>* placed) const;
 
+  // Same as above, but `occupied` holds the cells in row-major order and the
+  // placed cells are pushed to a preallocated stack that ends at
+  // `*placed_end`. Lift pops the stack back to `placed_begin`.
+  bool TryLand(int x, int y, int dir, char* occupied,
+               std::pair<int, int>** placed_end) const;
+
+  void Lift(char* occupied, const std::pair<int, int>* placed_begin,
+            std::pair<int, int>** placed_end) const;
+
   int AircraftSize() const { return aircraft_bodies_[0].size(); }
 
   const std::vector<std::pair<int, int>>& GetAircraftBody(int dir) const {
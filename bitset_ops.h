@@ -0,0 +1,146 @@
+#ifndef __BITSET_OPS_H
+#define __BITSET_OPS_H
+
+#include <cstdint>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+// Helpers over flat arrays of 64-bit words. Bitsets sized with BitsetWords
+// are padded to a multiple of kBitsetVectorWords words so the AVX2 path
+// never runs its scalar tail. The AVX2 path is only compiled in when the
+// build enables it (see SIMD_FLAGS in the Makefile).
+constexpr int kBitsetVectorWords = 4;
+
+inline int BitsetWords(const int num_bits) {
+  const int bits_per_vector = 64 * kBitsetVectorWords;
+  return (num_bits + bits_per_vector - 1) / bits_per_vector *
+         kBitsetVectorWords;
+}
+
+inline void BitsetSet(uint64_t* bits, const int i) {
+  bits[i >> 6] |= uint64_t(1) << (i & 63);
+}
+
+inline bool BitsetTest(const uint64_t* bits, const int i) {
+  return (bits[i >> 6] >> (i & 63)) & 1;
+}
+
+// out = a & b. Returns whether out has any bit set. `out` may alias `a` or
+// `b`.
+inline bool BitsetAnd(const uint64_t* a, const uint64_t* b, uint64_t* out,
+                      const int num_words) {
+  int i = 0;
+  uint64_t any = 0;
+#ifdef __AVX2__
+  __m256i any_vector = _mm256_setzero_si256();
+  for (; i + kBitsetVectorWords <= num_words; i += kBitsetVectorWords) {
+    const __m256i v = _mm256_and_si256(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), v);
+    any_vector = _mm256_or_si256(any_vector, v);
+  }
+  any = !_mm256_testz_si256(any_vector, any_vector);
+#endif
+  for (; i < num_words; i++) {
+    out[i] = a[i] & b[i];
+    any |= out[i];
+  }
+  return any != 0;
+}
+
+// out = a & ~b. Returns whether out has any bit set. `out` may alias `a` or
+// `b`.
+inline bool BitsetAndNot(const uint64_t* a, const uint64_t* b, uint64_t* out,
+                         const int num_words) {
+  int i = 0;
+  uint64_t any = 0;
+#ifdef __AVX2__
+  __m256i any_vector = _mm256_setzero_si256();
+  for (; i + kBitsetVectorWords <= num_words; i += kBitsetVectorWords) {
+    // _mm256_andnot_si256 computes ~first & second.
+    const __m256i v = _mm256_andnot_si256(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)),
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), v);
+    any_vector = _mm256_or_si256(any_vector, v);
+  }
+  any = !_mm256_testz_si256(any_vector, any_vector);
+#endif
+  for (; i < num_words; i++) {
+    out[i] = a[i] & ~b[i];
+    any |= out[i];
+  }
+  return any != 0;
+}
+
+// out |= a.
+inline void BitsetOr(const uint64_t* a, uint64_t* out, const int num_words) {
+  int i = 0;
+#ifdef __AVX2__
+  for (; i + kBitsetVectorWords <= num_words; i += kBitsetVectorWords) {
+    const __m256i v = _mm256_or_si256(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(out + i)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), v);
+  }
+#endif
+  for (; i < num_words; i++) {
+    out[i] |= a[i];
+  }
+}
+
+// Returns whether a & b has any bit set, without storing it.
+inline bool BitsetIntersects(const uint64_t* a, const uint64_t* b,
+                             const int num_words) {
+  int i = 0;
+#ifdef __AVX2__
+  for (; i + kBitsetVectorWords <= num_words; i += kBitsetVectorWords) {
+    if (!_mm256_testz_si256(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)))) {
+      return true;
+    }
+  }
+#endif
+  for (; i < num_words; i++) {
+    if ((a[i] & b[i]) != 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+inline int BitsetCount(const uint64_t* bits, const int num_words) {
+  int count = 0;
+  for (int i = 0; i < num_words; i++) {
+    count += __builtin_popcountll(bits[i]);
+  }
+  return count;
+}
+
+// Returns the number of bits set in a & b, without storing it.
+inline int BitsetAndCount(const uint64_t* a, const uint64_t* b,
+                          const int num_words) {
+  int count = 0;
+  for (int i = 0; i < num_words; i++) {
+    count += __builtin_popcountll(a[i] & b[i]);
+  }
+  return count;
+}
+
+// Calls f(i) for every set bit i in increasing order.
+template <typename F>
+inline void BitsetForEach(const uint64_t* bits, const int num_words, F f) {
+  for (int w = 0; w < num_words; w++) {
+    uint64_t word = bits[w];
+    while (word != 0) {
+      f(w * 64 + __builtin_ctzll(word));
+      word &= word - 1;
+    }
+  }
+}
+
+#endif
\ No newline at end of file
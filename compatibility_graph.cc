@@ -0,0 +1,29 @@
+#include "compatibility_graph.h"
+
+#include "bitset_ops.h"
+
+using namespace std;
+
+CompatibilityGraph::CompatibilityGraph(const PlacementTable& table)
+    : table_(table) {
+  const int n = table.NumPlacements();
+  num_words_ = table.NumPlacementWords();
+
+  // Placement i is compatible with every later placement that covers none of
+  // its cells.
+  compatible_.resize(n * num_words_);
+  vector<uint64_t> after(num_words_);
+  vector<uint64_t> conflicting(num_words_);
+  for (int i = n - 1; i >= 0; i--) {
+    table.GetOverlapping(i, conflicting.data());
+    BitsetAndNot(after.data(), conflicting.data(), &compatible_[i * num_words_],
+                 num_words_);
+    BitsetSet(after.data(), i);
+  }
+
+  covering_known_.resize((table.AircraftSize() + 1) * num_words_);
+  for (int i = 0; i < n; i++) {
+    BitsetSet(&covering_known_[table.GetPlacement(i).num_known * num_words_],
+              i);
+  }
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+#ifndef __COMPATIBILITY_GRAPH_H
+#define __COMPATIBILITY_GRAPH_H
+
+#include <cstdint>
+#include <vector>
+
+#include "placement_table.h"
+
+// For each placement i of a PlacementTable, the set of placements j > i that
+// do not overlap it. A fleet is then an n-clique of this graph.
+class CompatibilityGraph {
+ public:
+  explicit CompatibilityGraph(const PlacementTable& table);
+
+  int NumPlacements() const { return table_.NumPlacements(); }
+  int NumWords() const { return num_words_; }
+
+  const Placement& GetPlacement(int i) const { return table_.GetPlacement(i); }
+
+  const uint64_t* GetCompatible(int i) const {
+    return &compatible_[i * num_words_];
+  }
+
+  // Placements that cover exactly `num_known` known cells.
+  const uint64_t* GetPlacementsCoveringKnown(int num_known) const {
+    return &covering_known_[num_known * num_words_];
+  }
+
+ private:
+  const PlacementTable& table_;
+  int num_words_;
+  std::vector<uint64_t> compatible_;
+  std::vector<uint64_t> covering_known_;
+};
+
+#endif
\ No newline at end of file
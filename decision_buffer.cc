@@ -0,0 +1,120 @@
+#include "decision_buffer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include "color.h"
+
+using namespace std;
+
+void DecisionBuffer::Reset(const int rows, const int cols) {
+  const int num_cells = rows * cols;
+  size_ = sizeof(DecisionHeader) + num_cells * sizeof(DecisionCell) +
+          2 * num_cells * sizeof(int32_t);
+  const size_t num_words = (size_ + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+  if (storage_.size() < num_words) {
+    storage_.resize(num_words);
+  }
+  memset(storage_.data(), 0, size_);
+
+  DecisionHeader& header = GetHeader();
+  header.magic = kDecisionMagic;
+  header.version = kDecisionVersion;
+  header.rows = rows;
+  header.cols = cols;
+}
+
+void DecisionBuffer::WriteBinary(ostream& os) const {
+  os.write(Bytes(), size_);
+}
+
+void DecisionBuffer::WriteJson(ostream& os) const {
+  const DecisionHeader& header = GetHeader();
+  const int c = header.cols;
+  auto WriteCells = [&os, c](const int32_t* indices, const int n) {
+    os << "[";
+    for (int i = 0; i < n; i++) {
+      os << (i > 0 ? "," : "") << "[" << indices[i] / c << ","
+         << indices[i] % c << "]";
+    }
+    os << "]";
+  };
+  auto WriteNumber = [&os](const double value) {
+    if (isfinite(value)) {
+      os << value;
+    } else {
+      os << "null";
+    }
+  };
+
+  const streamsize precision = os.precision(17);
+  os << "{\"rows\":" << header.rows << ",\"cols\":" << header.cols
+     << ",\"num_configurations\":" << header.num_configurations
+     << ",\"picked\":";
+  WriteCells(GetPicked(), header.num_picked);
+  os << ",\"ranked\":";
+  WriteCells(GetRanked(), header.num_ranked);
+  os << ",\"cells\":[";
+  for (int i = 0; i < NumCells(); i++) {
+    const DecisionCell& cell = GetCells()[i];
+    os << (i > 0 ? "," : "") << "{\"x\":" << cell.x << ",\"y\":" << cell.y
+       << ",\"color\":\"" << static_cast<char>(cell.color)
+       << "\",\"red\":" << cell.red << ",\"blue\":" << cell.blue
+       << ",\"white\":" << cell.white << ",\"p_red\":";
+    WriteNumber(cell.p_red);
+    os << ",\"p_blue\":";
+    WriteNumber(cell.p_blue);
+    os << ",\"p_white\":";
+    WriteNumber(cell.p_white);
+    os << ",\"entropy\":";
+    WriteNumber(cell.entropy);
+    os << "}";
+  }
+  os << "]}";
+  os.precision(precision);
+}
+
+namespace {
+
+void PrintCell(const DecisionCell& cell) {
+  double max_probability = max(cell.p_red, max(cell.p_blue, cell.p_white));
+  int color_code;
+  if (cell.p_red == max_probability) {
+    color_code = 31;
+  } else if (cell.p_blue == max_probability) {
+    color_code = 34;
+  } else {
+    color_code = 30;
+  }
+
+  int style_code = 0;
+  if (cell.is_picked) {
+    style_code = 1;
+  } else if (static_cast<Color>(cell.color) != kGray) {
+    style_code = 9;
+  }
+  printf("\033[%d;%dm", style_code, color_code);
+  printf("%5.1f ", cell.entropy * 100);
+  printf("\33[0m");
+}
+
+}  // namespace
+
+void DecisionBuffer::PrintEntropyMatrix() const {
+  const DecisionHeader& header = GetHeader();
+  printf("  ");
+  for (int y = 0; y < header.cols; y++) {
+    printf("%6c", 'A' + y);
+  }
+  printf("\n");
+  for (int x = 0; x < header.rows; x++) {
+    printf("%2d: ", x + 1);
+    for (int y = 0; y < header.cols; y++) {
+      PrintCell(GetCell(x, y));
+    }
+    printf("\n");
+  }
+}
\ No newline at end of file
@@ -0,0 +1,86 @@
+#ifndef __DECISION_BUFFER_H
+#define __DECISION_BUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <type_traits>
+#include <vector>
+
+#include "decision_layout.h"
+
+static_assert(std::is_standard_layout<DecisionHeader>::value &&
+                  sizeof(DecisionHeader) == 32,
+              "DecisionHeader layout changed");
+static_assert(std::is_standard_layout<DecisionCell>::value &&
+                  sizeof(DecisionCell) == 72,
+              "DecisionCell layout changed");
+
+// Everything one enumeration tells: the header, then one DecisionCell per
+// cell in row-major order, then the row-major indices of the picked cells and
+// of the ranked candidates, rows * cols slots each. A buffer can be reused
+// across calls and only grows.
+class DecisionBuffer {
+ public:
+  // Starts as an empty 0x0 board, so that the header is always there.
+  DecisionBuffer() { Reset(0, 0); }
+
+  void Reset(int rows, int cols);
+
+  const DecisionHeader& GetHeader() const {
+    return *reinterpret_cast<const DecisionHeader*>(storage_.data());
+  }
+  DecisionHeader& GetHeader() {
+    return *reinterpret_cast<DecisionHeader*>(storage_.data());
+  }
+
+  const DecisionCell& GetCell(int x, int y) const {
+    return GetCells()[x * GetHeader().cols + y];
+  }
+  const DecisionCell* GetCells() const {
+    return reinterpret_cast<const DecisionCell*>(Bytes() +
+                                                 sizeof(DecisionHeader));
+  }
+  DecisionCell* GetCells() {
+    return const_cast<DecisionCell*>(
+        static_cast<const DecisionBuffer*>(this)->GetCells());
+  }
+
+  // The cells to bomb, best first.
+  const int32_t* GetPicked() const {
+    return reinterpret_cast<const int32_t*>(GetCells() + NumCells());
+  }
+  int32_t* GetPicked() {
+    return const_cast<int32_t*>(
+        static_cast<const DecisionBuffer*>(this)->GetPicked());
+  }
+
+  // The picked cells followed by the other gray cells, by decreasing
+  // entropy.
+  const int32_t* GetRanked() const { return GetPicked() + NumCells(); }
+  int32_t* GetRanked() { return GetPicked() + NumCells(); }
+
+  // The whole layout.
+  const void* Data() const { return storage_.data(); }
+  size_t Size() const { return size_; }
+
+  void WriteBinary(std::ostream& os) const;
+  // JSON has no NaN, so undefined probabilities are written as null.
+  void WriteJson(std::ostream& os) const;
+
+  // Prints the entropy of every cell, colored by its likeliest color, with
+  // the picked cells in bold and the known ones struck through.
+  void PrintEntropyMatrix() const;
+
+ private:
+  int NumCells() const { return GetHeader().rows * GetHeader().cols; }
+  const char* Bytes() const {
+    return reinterpret_cast<const char*>(storage_.data());
+  }
+
+  // In 64-bit words so that every field is aligned.
+  std::vector<uint64_t> storage_;
+  size_t size_ = 0;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,43 @@
+#ifndef __DECISION_LAYOUT_H
+#define __DECISION_LAYOUT_H
+
+#include <stdint.h>
+
+// The layout of a DecisionBuffer, in plain C so that a host can include it.
+// The structs only hold fixed-size fields in a fixed order, so that the host
+// can read a buffer in place or through the binary stream, with native
+// endianness.
+enum {
+  kDecisionMagic = 0x42444641,  // "AFDB"
+  kDecisionVersion = 1
+};
+
+typedef struct DecisionHeader {
+  uint32_t magic;
+  uint32_t version;
+  int32_t rows;
+  int32_t cols;
+  uint64_t num_configurations;
+  int32_t num_picked;
+  int32_t num_ranked;
+} DecisionHeader;
+
+typedef struct DecisionCell {
+  // Configurations in which the cell is red, blue or white.
+  uint64_t red;
+  uint64_t blue;
+  uint64_t white;
+  // NaN when no configuration is left.
+  double p_red;
+  double p_blue;
+  double p_white;
+  double entropy;
+  int32_t x;
+  int32_t y;
+  // The Color seen on the board, 'g' if not bombed yet.
+  uint8_t color;
+  uint8_t is_picked;
+  uint8_t reserved[6];
+} DecisionCell;
+
+#endif
\ No newline at end of file
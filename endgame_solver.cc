@@ -0,0 +1,333 @@
+#include "endgame_solver.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "bitset_ops.h"
+
+using namespace std;
+
+size_t EndgameSolver::Hash(const uint64_t* words, const int num_words) {
+  size_t hash = num_words;
+  for (int i = 0; i < num_words; i++) {
+    hash ^= words[i] + 0x9e3779b97f4a7c15 + (hash << 6) + (hash >> 2);
+  }
+  return hash;
+}
+
+size_t EndgameSolver::SubsetHash::operator()(const Subset& subset) const {
+  return Hash(subset.data(), subset.size());
+}
+
+EndgameSolver::EndgameSolver(const vector<vector<Color>>& configurations,
+                             const int num_aircrafts)
+    : num_configurations_(configurations.size()),
+      num_aircrafts_(num_aircrafts),
+      num_words_((configurations.size() + 63) / 64),
+      scratch_(configurations.size() + 1) {
+  const int num_cells = configurations[0].size();
+  cell_indices_.assign(num_cells, -1);
+  for (int cell = 0; cell < num_cells; cell++) {
+    Subset red(num_words_);
+    Subset blue(num_words_);
+    bool covered = false;
+    for (int i = 0; i < num_configurations_; i++) {
+      if (configurations[i][cell] == kRed) {
+        BitsetSet(red.data(), i);
+        covered = true;
+      } else if (configurations[i][cell] == kBlue) {
+        BitsetSet(blue.data(), i);
+        covered = true;
+      }
+    }
+    if (covered) {
+      cell_indices_[cell] = cells_.size();
+      cells_.push_back(cell);
+      red_.push_back(move(red));
+      blue_.push_back(move(blue));
+    }
+  }
+}
+
+bool EndgameSolver::Solve(const vector<Color>& board,
+                          const chrono::steady_clock::duration budget,
+                          int* cell) {
+  deadline_ = chrono::steady_clock::now() + budget;
+  num_nodes_ = 0;
+  out_of_time_ = false;
+
+  Subset subset(num_words_);
+  for (int i = 0; i < num_configurations_; i++) {
+    BitsetSet(subset.data(), i);
+  }
+  for (int i = 0, num_cells = board.size(); i < num_cells; i++) {
+    const int k = cell_indices_[i];
+    if (board[i] == kGray || (k < 0 && board[i] == kWhite)) {
+      continue;
+    }
+    if (k < 0) {
+      // No configuration covers the cell.
+      return false;
+    }
+    if (board[i] == kRed) {
+      BitsetAnd(subset.data(), red_[k].data(), subset.data(), num_words_);
+    } else if (board[i] == kBlue) {
+      BitsetAnd(subset.data(), blue_[k].data(), subset.data(), num_words_);
+    } else {
+      BitsetAndNot(subset.data(), red_[k].data(), subset.data(), num_words_);
+      BitsetAndNot(subset.data(), blue_[k].data(), subset.data(),
+                   num_words_);
+    }
+  }
+  if (BitsetCount(subset.data(), num_words_) == 0) {
+    return false;
+  }
+
+  vector<int> ks(cells_.size());
+  for (int k = 0, num_cells = cells_.size(); k < num_cells; k++) {
+    ks[k] = k;
+  }
+  int num_common_heads;
+  int max_red;
+  CountReds(subset.data(), ks, BitsetCount(subset.data(), num_words_),
+            &num_common_heads, &max_red);
+  int index = -1;
+  ExpectedGuesses(subset.data(), ks, num_common_heads,
+                  numeric_limits<double>::infinity(), 0, &index);
+  if (out_of_time_ || index < 0) {
+    return false;
+  }
+  *cell = cells_[index];
+  return true;
+}
+
+double EndgameSolver::ExpectedGuesses(const uint64_t* subset,
+                                      const vector<int>& ks,
+                                      const int num_common_heads,
+                                      const double cutoff, const int depth,
+                                      int* best_cell) {
+  const int num_remaining_heads = num_aircrafts_ - num_common_heads;
+  if (num_remaining_heads == 0) {
+    return 0.0;
+  }
+
+  Scratch& scratch = scratch_[depth];
+  scratch.key.assign(subset, subset + num_words_);
+  // The top level needs the cell, so it never reads the memo.
+  if (best_cell == nullptr) {
+    auto i = memo_.find(scratch.key);
+    if (i != memo_.end() &&
+        (i->second.is_exact || i->second.value >= cutoff)) {
+      return i->second.value;
+    }
+  }
+
+  if (OutOfTime()) {
+    return 0.0;
+  }
+
+  // Only cells on which the configurations disagree tell them apart, and a
+  // cell that splits none of the parent's configurations splits none of
+  // these either, so the children only look at `splitting`.
+  const int n = BitsetCount(subset, num_words_);
+  const int guess_words = 3 * num_words_;
+  vector<uint64_t>& outcomes = scratch.outcomes;
+  vector<int>& splitting = scratch.splitting;
+  vector<Guess>& guesses = scratch.guesses;
+  vector<int>& splits = scratch.splits;
+  outcomes.resize(ks.size() * guess_words);
+  splitting.clear();
+  guesses.clear();
+  int num_buckets = 1;
+  while (num_buckets < 2 * (int)ks.size()) {
+    num_buckets *= 2;
+  }
+  splits.assign(num_buckets, -1);
+  for (const int k : ks) {
+    const int g = guesses.size();
+    uint64_t* red = &outcomes[g * guess_words];
+    uint64_t* blue = red + num_words_;
+    uint64_t* white = blue + num_words_;
+    BitsetAnd(subset, red_[k].data(), red, num_words_);
+    BitsetAnd(subset, blue_[k].data(), blue, num_words_);
+    BitsetAndNot(subset, red_[k].data(), white, num_words_);
+    BitsetAndNot(white, blue_[k].data(), white, num_words_);
+    Guess guess;
+    guess.k = k;
+    int num_outcomes = 0;
+    for (int o = 0; o < 3; o++) {
+      guess.sizes[o] = BitsetCount(red + o * num_words_, num_words_);
+      num_outcomes += (guess.sizes[o] > 0);
+    }
+    if (num_outcomes < 2) {
+      continue;
+    }
+    splitting.push_back(k);
+
+    // Cells that split the configurations the same way are interchangeable.
+    // Blue and white only differ in name, so only the red part and the
+    // smaller of the other two identify a split.
+    auto NonRed = [this](const uint64_t* outcome) {
+      const uint64_t* blue = outcome + num_words_;
+      const uint64_t* white = blue + num_words_;
+      return lexicographical_compare(white, white + num_words_, blue,
+                                     blue + num_words_)
+                 ? white
+                 : blue;
+    };
+    const uint64_t* non_red = NonRed(red);
+    size_t bucket = (Hash(red, num_words_) * 31 + Hash(non_red, num_words_)) &
+                    (num_buckets - 1);
+    bool is_new = true;
+    for (; splits[bucket] >= 0 && is_new;
+         bucket = (bucket + 1) & (num_buckets - 1)) {
+      const uint64_t* other = &outcomes[splits[bucket] * guess_words];
+      is_new = !(equal(red, red + num_words_, other) &&
+                 equal(non_red, non_red + num_words_, NonRed(other)));
+    }
+    if (!is_new) {
+      continue;
+    }
+    splits[bucket] = g;
+
+    // Every head left takes a guess, and this one is a guess that is not
+    // a head unless it comes out red. The bounds from the outcomes are only
+    // worked out once the guess is about to be tried.
+    guess.has_bounds = false;
+    guess.lower_bound = 1.0;
+    for (int o = 0; o < 3; o++) {
+      if (guess.sizes[o] > 0) {
+        guess.lower_bound += static_cast<double>(guess.sizes[o]) / n *
+                             (num_remaining_heads - (o == 0));
+      }
+    }
+    guesses.push_back(guess);
+  }
+
+  // Tries the guesses by increasing lower bound, earlier ones first on ties.
+  // A guess whose bounds are not worked out yet goes back in the queue once
+  // they are, since they only raise its lower bound.
+  vector<int>& queue = scratch.queue;
+  queue.resize(guesses.size());
+  for (int g = 0, num_guesses = guesses.size(); g < num_guesses; g++) {
+    queue[g] = g;
+  }
+  auto After = [&guesses](const int a, const int b) {
+    return guesses[a].lower_bound > guesses[b].lower_bound ||
+           (guesses[a].lower_bound == guesses[b].lower_bound && a > b);
+  };
+  make_heap(queue.begin(), queue.end(), After);
+
+  // Only values below `cutoff` matter to the caller. If no guess gets below
+  // it, `cutoff` is returned as a lower bound. Sums of lower bounds that tie
+  // `best` must not win by rounding, hence the slack.
+  constexpr double kEpsilon = 1e-9;
+  double best = cutoff;
+  bool is_exact = false;
+  while (!queue.empty()) {
+    pop_heap(queue.begin(), queue.end(), After);
+    const int g = queue.back();
+    Guess& guess = guesses[g];
+    if (guess.lower_bound >= best - kEpsilon) {
+      break;
+    }
+    const uint64_t* guess_outcomes = &outcomes[g * guess_words];
+    if (!guess.has_bounds) {
+      BoundGuess(guess_outcomes, splitting, n, num_common_heads, &guess);
+      push_heap(queue.begin(), queue.end(), After);
+      continue;
+    }
+    queue.pop_back();
+
+    // `expected` counts the evaluated outcomes exactly and the others by
+    // their lower bounds.
+    double expected = guess.lower_bound;
+    for (int o = 0; o < 3 && expected < best - kEpsilon; o++) {
+      if (guess.sizes[o] == 0) {
+        continue;
+      }
+      const double p = static_cast<double>(guess.sizes[o]) / n;
+      expected -= p * guess.lower_bounds[o];
+      const double next_cutoff =
+          (best - expected) / p - guess.num_sure_hits[o];
+      expected += p * (guess.num_sure_hits[o] +
+                       ExpectedGuesses(guess_outcomes + o * num_words_,
+                                       splitting, guess.num_common_heads[o],
+                                       next_cutoff, depth + 1, nullptr));
+      if (out_of_time_) {
+        return 0.0;
+      }
+    }
+
+    if (expected < best - kEpsilon) {
+      best = expected;
+      is_exact = true;
+      if (best_cell != nullptr) {
+        *best_cell = guess.k;
+      }
+    }
+  }
+
+  memo_[scratch.key] = MemoEntry{best, is_exact};
+  return best;
+}
+
+void EndgameSolver::BoundGuess(const uint64_t* outcomes, const vector<int>& ks,
+                               const int size, const int num_common_heads,
+                               Guess* guess) const {
+  guess->has_bounds = true;
+  guess->lower_bound = 1.0;
+  for (int o = 0; o < 3; o++) {
+    if (guess->sizes[o] == 0) {
+      continue;
+    }
+    // Heads that every remaining configuration agrees on are bombed right
+    // away.
+    int num_new_common_heads;
+    int max_red;
+    CountReds(outcomes + o * num_words_, ks, guess->sizes[o],
+              &num_new_common_heads, &max_red);
+    guess->num_common_heads[o] = num_common_heads + num_new_common_heads;
+    guess->num_sure_hits[o] = num_new_common_heads - (o == 0);
+    guess->lower_bounds[o] =
+        guess->num_sure_hits[o] +
+        LowerBound(guess->sizes[o], guess->num_common_heads[o], max_red);
+    guess->lower_bound +=
+        static_cast<double>(guess->sizes[o]) / size * guess->lower_bounds[o];
+  }
+}
+
+double EndgameSolver::LowerBound(const int size, const int num_common_heads,
+                                 const int max_red) const {
+  const int num_remaining_heads = num_aircrafts_ - num_common_heads;
+  if (num_remaining_heads == 0) {
+    return 0.0;
+  }
+  // The next guess hits at most one head, and only with the probability of
+  // the likeliest head that is not bombed yet.
+  return 1.0 + num_remaining_heads - static_cast<double>(max_red) / size;
+}
+
+void EndgameSolver::CountReds(const uint64_t* subset, const vector<int>& ks,
+                              const int size, int* num_common_heads,
+                              int* max_red) const {
+  *num_common_heads = 0;
+  *max_red = 0;
+  for (const int k : ks) {
+    const int num_red = BitsetAndCount(subset, red_[k].data(), num_words_);
+    if (num_red == size) {
+      ++*num_common_heads;
+    } else {
+      *max_red = max(*max_red, num_red);
+    }
+  }
+}
+
+bool EndgameSolver::OutOfTime() {
+  constexpr int kNodesPerClockCheck = 256;
+  if (!out_of_time_ && ++num_nodes_ % kNodesPerClockCheck == 0 &&
+      chrono::steady_clock::now() >= deadline_) {
+    out_of_time_ = true;
+  }
+  return out_of_time_;
+}
\ No newline at end of file
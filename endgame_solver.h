@@ -0,0 +1,122 @@
+#ifndef __ENDGAME_SOLVER_H
+#define __ENDGAME_SOLVER_H
+
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "color.h"
+
+// Finds the guess that minimizes the expected number of guesses left until
+// every head is bombed, by an exact expectimax over a small explicit set of
+// equally likely configurations. Every red cell shared by all configurations
+// that match the board must already be bombed.
+class EndgameSolver {
+ public:
+  // Each configuration holds the color of every cell in row-major order.
+  EndgameSolver(const std::vector<std::vector<Color>>& configurations,
+                int num_aircrafts);
+
+  // Searches the configurations that match every non-gray cell of `board`,
+  // given in row-major order. Stores the best cell in `cell` and returns
+  // true, or returns false if none matches or `budget` runs out first. The
+  // memo outlives the call, so the next move of the same game, whose board
+  // only adds colors, mostly reads the results of this one.
+  bool Solve(const std::vector<Color>& board,
+             std::chrono::steady_clock::duration budget, int* cell);
+
+ private:
+  // A set of configurations, as a bitset of num_words_ words.
+  using Subset = std::vector<uint64_t>;
+
+  static size_t Hash(const uint64_t* words, int num_words);
+
+  struct SubsetHash {
+    size_t operator()(const Subset& subset) const;
+  };
+
+  struct MemoEntry {
+    double value;
+    // Otherwise `value` is only a lower bound.
+    bool is_exact;
+  };
+
+  // A guess and how many configurations are left after each of its
+  // outcomes, red, blue and white. The outcomes themselves live in the
+  // Scratch of the node.
+  struct Guess {
+    int k;
+    int sizes[3];
+    // Otherwise only `lower_bound` is set, to the bound that only counts the
+    // heads left.
+    bool has_bounds;
+    int num_common_heads[3];
+    int num_sure_hits[3];
+    double lower_bounds[3];
+    double lower_bound;
+  };
+
+  // Memory that every node at one depth of the search reuses, so the search
+  // does not allocate once it has gone that deep before.
+  struct Scratch {
+    // The subset of the node, to look up the memo.
+    Subset key;
+    // The three outcomes of guess g start at word 3 * g * num_words_.
+    std::vector<uint64_t> outcomes;
+    std::vector<int> splitting;
+    std::vector<Guess> guesses;
+    // Open addressing table of guesses by split, -1 where empty.
+    std::vector<int> splits;
+    // The guesses left to try, as a heap on their lower bounds.
+    std::vector<int> queue;
+  };
+
+  // Expected number of guesses left for the configurations in `subset`, or a
+  // lower bound of it that is at least `cutoff`. `num_common_heads` is the
+  // number of cells that are red in all of them. `ks` indexes the cells_
+  // that may still split `subset`: every cell left out must have the same
+  // color in all of its configurations. `depth` picks the Scratch.
+  double ExpectedGuesses(const uint64_t* subset, const std::vector<int>& ks,
+                         int num_common_heads, double cutoff, int depth,
+                         int* best_cell);
+
+  // Fills the lower bounds of `guess`, whose outcomes start at `outcomes`.
+  void BoundGuess(const uint64_t* outcomes, const std::vector<int>& ks,
+                  int size, int num_common_heads, Guess* guess) const;
+
+  // A cheap lower bound of ExpectedGuesses for `size` configurations that
+  // share `num_common_heads` heads and in which no other cell is red more
+  // than `max_red` times.
+  double LowerBound(int size, int num_common_heads, int max_red) const;
+
+  // Counts the cells among `ks` that are red in every configuration of
+  // `subset` into `num_common_heads`, and stores the largest number of
+  // configurations in which any other of them is red in `max_red`.
+  void CountReds(const uint64_t* subset, const std::vector<int>& ks,
+                 int size, int* num_common_heads, int* max_red) const;
+
+  bool OutOfTime();
+
+  const int num_configurations_;
+  const int num_aircrafts_;
+  const int num_words_;
+  // Cells that are red or blue in at least one configuration, and for each of
+  // them the configurations in which it is red or blue.
+  std::vector<int> cells_;
+  // The index in cells_ of every cell, or -1.
+  std::vector<int> cell_indices_;
+  std::vector<Subset> red_;
+  std::vector<Subset> blue_;
+
+  std::unordered_map<Subset, MemoEntry, SubsetHash> memo_;
+  // One per depth. Every guess splits a subset, so the search is at most
+  // num_configurations_ deep.
+  std::vector<Scratch> scratch_;
+
+  std::chrono::steady_clock::time_point deadline_;
+  int num_nodes_ = 0;
+  bool out_of_time_ = false;
+};
+
+#endif
\ No newline at end of file
@@ -5,7 +5,7 @@
 
 using namespace std;
 
-void BM_Finder(benchmark::State& state) {
+void RunFinder(benchmark::State& state, const Engine engine) {
   const int rows = state.range(0);
   const int cols = state.range(1);
   const int num_aircrafts = state.range(2);
@@ -16,6 +16,7 @@ void BM_Finder(benchmark::State& state) {
 
   for (auto _ : state) {
     AircraftFinder finder(rows, cols, num_aircrafts);
+    finder.SetEngine(engine);
     int num_remaining_aircrafts = num_aircrafts;
     while (num_remaining_aircrafts > 0) {
       int x;
@@ -29,7 +30,19 @@ void BM_Finder(benchmark::State& state) {
   }
 }
 
+void BM_Finder(benchmark::State& state) { RunFinder(state, kDFSEngine); }
+
+void BM_FinderWithCompatibilityGraph(benchmark::State& state) {
+  RunFinder(state, kCompatibilityGraphEngine);
+}
+
 BENCHMARK(BM_Finder)
+    ->Args({10, 10, 2})
+    ->Args({15, 12, 3})
+    ->Args({18, 15, 3})
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_FinderWithCompatibilityGraph)
     ->Args({10, 10, 2})
     ->Args({15, 12, 3})
     ->Args({18, 15, 3})
@@ -0,0 +1,57 @@
+#include "placement_table.h"
+
+#include <algorithm>
+
+#include "bitset_ops.h"
+
+using namespace std;
+
+PlacementTable::PlacementTable(const vector<vector<Color>>& board,
+                               const AircraftPlacer& placer,
+                               vector<vector<bool>> occupied)
+    : c_(board[0].size()), aircraft_size_(placer.AircraftSize()) {
+  const int r = board.size();
+  num_cell_words_ = BitsetWords(r * c_);
+  indices_.assign(r * c_ * 4, -1);
+  first_after_.resize(r * c_);
+  covering_known_.resize(aircraft_size_ + 1);
+
+  vector<pair<int, int>> placed;
+  placed.reserve(aircraft_size_);
+  for (int x = 0; x < r; x++) {
+    for (int y = 0; y < c_; y++) {
+      for (int dir = 0; dir < 4; dir++) {
+        if (placer.TryLand(x, y, dir, &occupied, &placed)) {
+          const int i = placements_.size();
+          int num_known = 0;
+          footprints_.resize((i + 1) * num_cell_words_);
+          for (const pair<int, int>& p : placed) {
+            num_known += (board[p.first][p.second] != kGray);
+            BitsetSet(&footprints_[i * num_cell_words_], p.first * c_ + p.second);
+          }
+          placements_.push_back(Placement{x, y, dir, num_known});
+          indices_[(x * c_ + y) * 4 + dir] = i;
+          covering_known_[num_known].push_back(i);
+        }
+        placer.Lift(&occupied, &placed);
+      }
+      first_after_[x * c_ + y] = placements_.size();
+    }
+  }
+
+  const int n = placements_.size();
+  num_placement_words_ = BitsetWords(n);
+  covering_.resize(num_cell_words_ * 64 * num_placement_words_);
+  for (int i = 0; i < n; i++) {
+    BitsetForEach(GetFootprint(i), num_cell_words_, [&](int cell) {
+      BitsetSet(&covering_[cell * num_placement_words_], i);
+    });
+  }
+}
+
+void PlacementTable::GetOverlapping(const int i, uint64_t* overlapping) const {
+  fill(overlapping, overlapping + num_placement_words_, 0);
+  BitsetForEach(GetFootprint(i), num_cell_words_, [&](int cell) {
+    BitsetOr(GetCovering(cell), overlapping, num_placement_words_);
+  });
+}
\ No newline at end of file
@@ -0,0 +1,77 @@
+#ifndef __PLACEMENT_TABLE_H
+#define __PLACEMENT_TABLE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "aircraft_placer.h"
+#include "color.h"
+
+struct Placement {
+  int x;
+  int y;
+  int dir;
+  // Number of red or blue cells on the board covered by this placement.
+  int num_known;
+};
+
+// Lists every placement that is legal on its own for the current board and
+// avoids the `occupied` cells, in (x, y, dir) order, together with the cells
+// it covers.
+class PlacementTable {
+ public:
+  PlacementTable(const std::vector<std::vector<Color>>& board,
+                 const AircraftPlacer& placer,
+                 std::vector<std::vector<bool>> occupied);
+
+  int NumPlacements() const { return placements_.size(); }
+  int AircraftSize() const { return aircraft_size_; }
+
+  const Placement& GetPlacement(int i) const { return placements_[i]; }
+
+  // The cells covered by placement i, as a bitset over the cells in
+  // row-major order.
+  int NumCellWords() const { return num_cell_words_; }
+  const uint64_t* GetFootprint(int i) const {
+    return &footprints_[i * num_cell_words_];
+  }
+
+  // The placements covering each cell, as bitsets over the placements.
+  int NumPlacementWords() const { return num_placement_words_; }
+  const uint64_t* GetCovering(int cell) const {
+    return &covering_[cell * num_placement_words_];
+  }
+
+  // Sets `overlapping` to the placements sharing a cell with placement i,
+  // including i itself.
+  void GetOverlapping(int i, uint64_t* overlapping) const;
+
+  // Returns the index of the placement with its head at (x, y) facing `dir`,
+  // or -1 if that placement is not legal.
+  int Find(int x, int y, int dir) const {
+    return indices_[(x * c_ + y) * 4 + dir];
+  }
+
+  // Returns the index of the first placement whose head comes after (x, y)
+  // in row-major order.
+  int FirstAfter(int x, int y) const { return first_after_[x * c_ + y]; }
+
+  // Placements that cover exactly `num_known` known cells, in order.
+  const std::vector<int>& GetPlacementsCoveringKnown(int num_known) const {
+    return covering_known_[num_known];
+  }
+
+ private:
+  const int c_;
+  const int aircraft_size_;
+  std::vector<Placement> placements_;
+  int num_cell_words_;
+  std::vector<uint64_t> footprints_;
+  int num_placement_words_;
+  std::vector<uint64_t> covering_;
+  std::vector<int> indices_;
+  std::vector<int> first_after_;
+  std::vector<std::vector<int>> covering_known_;
+};
+
+#endif
\ No newline at end of file